@@ -19,3 +19,70 @@ instrument VARCHAR(15) NOT NULL,
 PRIMARY KEY (dt, instrument, price, size, exchange)
 );
 
+CREATE TABLE IF NOT EXISTS ib.mid_point_data (
+dt datetime(6) NOT NULL,
+midPoint DECIMAL(12, 5) NOT NULL,
+instrument VARCHAR(15) NOT NULL,
+PRIMARY KEY (dt, instrument, midPoint)
+);
+
+CREATE TABLE IF NOT EXISTS ib.depth_data (
+dt datetime(6) NOT NULL,
+position INT(12) NOT NULL,
+operation TINYINT NOT NULL,
+side TINYINT NOT NULL,
+price DECIMAL(12, 5) NOT NULL,
+size INT(12) NOT NULL,
+marketMaker VARCHAR(15) NOT NULL,
+instrument VARCHAR(15) NOT NULL,
+PRIMARY KEY (dt, instrument, position, operation, side, price, size, marketMaker)
+);
+
+CREATE TABLE IF NOT EXISTS ib.bar_data (
+dt datetime(6) NOT NULL,
+open DECIMAL(12, 5) NOT NULL,
+high DECIMAL(12, 5) NOT NULL,
+low DECIMAL(12, 5) NOT NULL,
+close DECIMAL(12, 5) NOT NULL,
+volume BIGINT NOT NULL,
+wap DECIMAL(12, 5) NOT NULL,
+count INT(12) NOT NULL,
+instrument VARCHAR(15) NOT NULL,
+PRIMARY KEY (dt, instrument, open, high, low, close, volume, wap, count)
+);
+
+CREATE TABLE IF NOT EXISTS ib.depth_snapshot_data (
+dt datetime(6) NOT NULL,
+side TINYINT NOT NULL,
+position INT(12) NOT NULL,
+price DECIMAL(12, 5) NOT NULL,
+size INT(12) NOT NULL,
+instrument VARCHAR(15) NOT NULL,
+PRIMARY KEY (dt, instrument, side, position, price, size)
+);
+
+CREATE TABLE IF NOT EXISTS ib.trade_bars_1s (
+dt datetime(6) NOT NULL,
+open DECIMAL(12, 5) NOT NULL,
+high DECIMAL(12, 5) NOT NULL,
+low DECIMAL(12, 5) NOT NULL,
+close DECIMAL(12, 5) NOT NULL,
+volume BIGINT NOT NULL,
+vwap DECIMAL(12, 5) NOT NULL,
+count INT(12) NOT NULL,
+instrument VARCHAR(15) NOT NULL,
+PRIMARY KEY (dt, instrument, open, high, low, close, volume, vwap, count)
+);
+
+CREATE TABLE IF NOT EXISTS ib.trade_bars_1m (
+dt datetime(6) NOT NULL,
+open DECIMAL(12, 5) NOT NULL,
+high DECIMAL(12, 5) NOT NULL,
+low DECIMAL(12, 5) NOT NULL,
+close DECIMAL(12, 5) NOT NULL,
+volume BIGINT NOT NULL,
+vwap DECIMAL(12, 5) NOT NULL,
+count INT(12) NOT NULL,
+instrument VARCHAR(15) NOT NULL,
+PRIMARY KEY (dt, instrument, open, high, low, close, volume, vwap, count)
+);
@@ -28,6 +28,9 @@
 #include "CommonDefs.h"
 #include "AccountSummaryTags.h"
 #include "Utils.h"
+#include "EThreadAffinity.h"
+#include "EMessageFilter.h"
+#include "EReplay.h"
 
 #include <stdio.h>
 #include <chrono>
@@ -36,27 +39,94 @@
 #include <ctime>
 #include <fstream>
 #include <cstdint>
+#include <cstdlib> // std::getenv
 
 
 
-EminiLogger::EminiLogger() :
+// the messages that get persisted; false if everything is wanted
+// (IB_DECODE_ALL=1 decodes everything)
+static bool persistedMessages(EMessageFilter& filter)
+{
+	const char* decodeAll = std::getenv("IB_DECODE_ALL");
+	if (decodeAll && std::atoi(decodeAll))
+		return false;
+
+	filter.wantNone();
+	filter.want(NEXT_VALID_ID);
+	filter.want(TICK_BY_TICK);
+	filter.want(MARKET_DEPTH);
+	filter.want(MARKET_DEPTH_L2);
+	filter.want(REAL_TIME_BARS);
+	return true;
+}
+
+
+static std::int64_t sinceEpoch(const hft::TimePoint& time)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+
+// what the ib_ticks_total counters are kept by, besides the instrument
+enum TickKind { TICK_TRADE, TICK_BID_ASK, TICK_MID_POINT, TICK_DEPTH, TICK_BAR, NUM_TICK_KINDS };
+static const char* const TICK_KIND_NAMES[NUM_TICK_KINDS] = {"trade", "bid_ask", "mid_point", "depth", "bar"};
+
+// histogram buckets: flushes and ticks in seconds, bundles in rows
+static const std::vector<double> FLUSH_SECONDS = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+static const std::vector<double> TICK_SECONDS = {0.000001, 0.000005, 0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1};
+static const std::vector<double> BUNDLE_ROWS = {1, 10, 100, 1000, 10000, 100000};
+
+
+EminiLogger::EminiLogger(hft::MetricsRegistry* metrics) :
       m_osSignal(2000)//2-seconds timeout
     , m_pClient(new EClientSocket(this, &m_osSignal))
 	, m_state(ST_CONNECT)
     , m_pReader(0)
     , m_extraAuth(false)
     , m_printing(true)
+    , m_latency_dump_s(60)
+    , m_last_latency_dump(hft::ClockType::now())
     , m_tick_writer("/usr/src/app/IBJts/samples/Cpp/TestCppClient/mysql_config.txt", 
                    "/usr/src/app/IBJts/samples/Cpp/TestCppClient/tickers.txt",
                     10, // auto flush every ten ticks
                     true, // printing
                     true) // reconnect to db    
+    , m_metrics(metrics)
 {
+	// IB_WAIT=spin|spinpark trades a core for a faster wakeup when ticks arrive
+	// (IB_WAIT_SPINS polls before parking, for spinpark)
+	const char* wait = std::getenv("IB_WAIT");
+	const char* spins = std::getenv("IB_WAIT_SPINS");
+	unsigned int nspins = spins ? std::atoi(spins) : 20000;
+	if (wait && std::string(wait) == "spin")
+		m_osSignal.setWaitStrategy(EReaderOSSignal::WAIT_SPIN);
+	else if (wait && std::string(wait) == "spinpark" && !m_osSignal.setWaitStrategy(EReaderOSSignal::WAIT_SPIN_THEN_PARK, nspins))
+		printf( "spin-then-park is not available, blocking\n");
+
+	// every tick's latency, stage by stage, unless IB_LATENCY_TRACE=0
+	// (IB_LATENCY_DUMP_S=N prints it every N seconds, 0 never)
+	const char* trace = std::getenv("IB_LATENCY_TRACE");
+	if (!trace || std::atoi(trace)) {
+		std::vector<std::string> names;
+		for (unsigned int i = 0; i < m_tick_writer.size(); ++i)
+			names.push_back(m_tick_writer.loc_syms(i));
+		m_latency.reset(new hft::LatencyTrace(names));
+		m_tick_writer.traceCommits(m_latency.get());
+	}
+	const char* dump = std::getenv("IB_LATENCY_DUMP_S");
+	if (dump)
+		m_latency_dump_s = std::atoi(dump);
+
+	if (m_metrics)
+		exportMetrics();
 }
 
 
 EminiLogger::~EminiLogger()
 {
+    // nothing may read the reader or the tick writer after this
+    if (m_metrics)
+        m_metrics->remove(this);
     if (m_pReader)
         delete m_pReader;
     delete m_pClient;
@@ -71,6 +141,35 @@ bool EminiLogger::connect(const char *host, int port, int clientId)
 	if (bRes) {
 		printf( "Connected to %s:%d clientId:%d\n", m_pClient->host().c_str(), m_pClient->port(), clientId);
         	m_pReader = new EReader(m_pClient, &m_osSignal);
+		// IB_READER=epoll waits on the socket with epoll instead of select
+		const char* reader = std::getenv("IB_READER");
+		if (reader && std::string(reader) == "epoll" && !m_pReader->useEpoll(true))
+			printf( "epoll is not available, using select\n");
+		// IB_QUEUE_SIZE=N hands messages over through a lock-free ring of N
+		const char* queueSize = std::getenv("IB_QUEUE_SIZE");
+		if (queueSize && std::atoi(queueSize) > 0)
+			m_pReader->useLockFreeQueue(std::atoi(queueSize));
+		// IB_READER_CPU / IB_DECODER_CPU pin the reader thread / this thread
+		const char* readerCpu = std::getenv("IB_READER_CPU");
+		if (readerCpu)
+			m_pReader->setCpu(std::atoi(readerCpu));
+		const char* decoderCpu = std::getenv("IB_DECODER_CPU");
+		if (decoderCpu && !ePinCurrentThread(std::atoi(decoderCpu)))
+			printf( "cannot pin the decoder thread to cpu %s\n", decoderCpu);
+		// trades' exchanges are read straight out of the message
+		m_pReader->useViewCallbacks(this);
+		// only decode what gets persisted
+		EMessageFilter filter;
+		if (persistedMessages(filter))
+			m_pReader->setMessageFilter(filter);
+		// IB_CAPTURE=file appends everything the gateway sends to file, for IB_REPLAY
+		const char* capture = std::getenv("IB_CAPTURE");
+		if (capture && !m_pReader->captureTo(capture))
+			printf( "cannot capture to %s\n", capture);
+		if (m_latency)
+			m_pReader->traceLatency(true);
+		if (m_metrics)
+			exportReaderMetrics();
 		m_pReader->start();
 	}
 	else
@@ -79,6 +178,47 @@ bool EminiLogger::connect(const char *host, int port, int clientId)
     return bRes;
 }
 
+bool EminiLogger::replay(const char *path, bool paced)
+{
+	EReplay replay(this);
+	if (!replay.open(path)) {
+		printf( "Cannot replay %s\n", path);
+		return false;
+	}
+
+	replay.setPaced(paced);
+	replay.useViewCallbacks(this);
+	EMessageFilter filter;
+	if (persistedMessages(filter))
+		replay.setMessageFilter(filter);
+
+	printf( "Replaying %s%s\n", path, paced ? " at its recorded pace" : "");
+	auto start = std::chrono::steady_clock::now();
+
+	while (replay.next()) {
+		// what processMessages() does after each batch
+		if (replay.messages() % 256 == 0) {
+			hft::TimePoint now = hft::ClockType::now();
+			m_tick_writer.snapshotBooks(now);
+			m_tick_writer.closeBars(now);
+		}
+	}
+	hft::TimePoint now = hft::ClockType::now();
+	m_tick_writer.snapshotBooks(now);
+	m_tick_writer.closeBars(now);
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf( "Replayed %llu messages (%llu bytes, %llu bad) in %.3f s: %.0f messages/s\n",
+		replay.messages(), replay.bytes(), replay.bad(), seconds, seconds > 0 ? replay.messages() / seconds : 0.0);
+	// a replay has no reader, so only the stages after the callbacks
+	if (m_latency) {
+		m_tick_writer.flushToDB();
+		m_latency->print(stdout);
+	}
+	return true;
+}
+
+
 void EminiLogger::disconnect() const
 {
 	m_pClient->eDisconnect();
@@ -134,6 +274,16 @@ void EminiLogger::processMessages()
 	m_osSignal.waitForSignal();
 	errno = 0;
 	m_pReader->processMsgs();
+
+	// books and bars of instruments that went quiet still get written
+	hft::TimePoint now = hft::ClockType::now();
+	m_tick_writer.snapshotBooks(now);
+	m_tick_writer.closeBars(now);
+
+	if (m_latency && m_latency_dump_s > 0 && now - m_last_latency_dump >= std::chrono::seconds(m_latency_dump_s)) {
+		m_latency->print(stdout);
+		m_last_latency_dump = now;
+	}
 }
 
 
@@ -146,43 +296,64 @@ void EminiLogger::connectAck() {
 
 void EminiLogger::unsubscribeAll(){
     for(unsigned int i = 0; i < m_tick_writer.size(); ++i){
-        std::string ticker = m_tick_writer.loc_syms(i); 
-        //m_pClient->cancelMktData(m_tick_writer.unique_order_id(ticker));
-        m_pClient->cancelMktData(m_tick_writer.unique_trade_id(ticker));
+        for(unsigned s = 0; s < hft::NUM_STREAMS; ++s){
+            hft::StreamType stream = static_cast<hft::StreamType>(s);
+            if( !(m_tick_writer.streams(i) & hft::streamBit(stream)) )
+                continue;
+            unsigned int reqId = m_tick_writer.request_id(i, stream);
+            if( stream == hft::STREAM_DEPTH )
+                m_pClient->cancelMktDepth(reqId, false);
+            else if( stream == hft::STREAM_BARS )
+                m_pClient->cancelRealTimeBars(reqId);
+            else
+                m_pClient->cancelTickByTickData(reqId);
+        }
     }
 }
 
 
-void EminiLogger::reqAllData()
+Contract EminiLogger::contract(unsigned int idx) const
 {
+    Contract contract;
+    contract.symbol  = m_tick_writer.syms(idx);
+    contract.secType = m_tick_writer.sec_types(idx);
+    contract.currency = m_tick_writer.currencies(idx);
+    contract.exchange = m_tick_writer.exchs(idx);
+    // TODO make the next few lines not futures specific
+    contract.localSymbol = m_tick_writer.loc_syms(idx);
+    return contract;
+}
 
-    // TODO: manually edit this function to change your requests to either trade or order data
-    // also have to change the unsubscribeAll function above
+
+void EminiLogger::reqAllData()
+{
+    // the streams each instrument wants are listed in tickers.txt
 
     if(m_printing) std::cout << "now requesting data...\n";
 
     for(unsigned int i = 0; i < m_tick_writer.size(); ++i){
-        Contract contract;
-        contract.symbol  = m_tick_writer.syms(i);
-        contract.secType = m_tick_writer.sec_types(i);
-        contract.currency = m_tick_writer.currencies(i);
-        contract.exchange = m_tick_writer.exchs(i);
-        // TODO make the next few lines not futures specific
-        contract.localSymbol = m_tick_writer.loc_syms(i);
-
-        if(m_printing) std::cout << "requesting trade or order data for " << contract.symbol << "\n";
-
-//        m_pClient->reqTickByTickData(m_tick_writer.unique_order_id(contract.localSymbol), 
-//                                     contract, 
-//                                     "BidAsk", 
-//                                     0, // nonzero means historical data too
-//                                     true); // ignore size only changes
-
-        m_pClient->reqTickByTickData(m_tick_writer.unique_trade_id(contract.localSymbol), 
-                                     contract, 
-                                     "Last", 
-                                     0, // nonzero means historical data too
-                                     true); // ignore size only changes?
+        Contract contract = this->contract(i);
+
+        for(unsigned s = 0; s < hft::NUM_STREAMS; ++s){
+            hft::StreamType stream = static_cast<hft::StreamType>(s);
+            if( !(m_tick_writer.streams(i) & hft::streamBit(stream)) )
+                continue;
+
+            if(m_printing) std::cout << "requesting " << hft::FutSymsConfig::stream_name(stream) 
+                                     << " data for " << contract.localSymbol << "\n";
+
+            unsigned int reqId = m_tick_writer.request_id(i, stream);
+            if( stream == hft::STREAM_DEPTH )
+                m_pClient->reqMktDepth(reqId, contract, hft::BOOK_DEPTH, false, TagValueListSPtr());
+            else if( stream == hft::STREAM_BARS )
+                m_pClient->reqRealTimeBars(reqId, contract, 5, "TRADES", false, TagValueListSPtr());
+            else
+                m_pClient->reqTickByTickData(reqId, 
+                                             contract, 
+                                             hft::FutSymsConfig::stream_name(stream), 
+                                             0, // nonzero means historical data too
+                                             true); // ignore size only changes
+        }
     }
 }
 
@@ -198,6 +369,11 @@ void EminiLogger::nextValidId( OrderId orderId)
 void EminiLogger::error(int id, int errorCode, const std::string& errorString)
 {
 	printf( "Error. Id: %d, Code: %d, Msg: %s\n", id, errorCode, errorString.c_str());
+
+	// 317: market depth was reset, so the book has to start over
+	hft::InstrumentId instrument = m_tick_writer.instrument_from_uid(id);
+	if (errorCode == 317 && instrument != hft::NO_INSTRUMENT)
+		m_tick_writer.resetBook(instrument);
 }
 
 
@@ -209,13 +385,27 @@ void EminiLogger::connectionClosed() {
 
 
 void EminiLogger::tickByTickAllLast(int reqId, int tickType, time_t time, double price, int size, const TickAttribLast& tickAttribLast, const std::string& exchange, const std::string& specialConditions) {
+    tickByTickAllLast(reqId, tickType, time, price, size, tickAttribLast,
+                      EStringView(exchange.c_str(), exchange.size()), EStringView(specialConditions.c_str(), specialConditions.size()));
+}
+
+
+void EminiLogger::tickByTickAllLast(int reqId, int tickType, time_t time, double price, int size, const TickAttribLast& tickAttribLast, EStringView exchange, EStringView specialConditions) {
     if(m_printing){
         printf("Tick-By-Tick. ReqId: %d, TickType: %s, Time: %s, Price: %g, Size: %d, PastLimit: %d, Unreported: %d, Exchange: %s, SpecialConditions:%s\n", 
             reqId, (tickType == 1 ? "Last" : "AllLast"), ctime(&time), price, size, tickAttribLast.pastLimit, tickAttribLast.unreported, exchange.c_str(), specialConditions.c_str());
         std::cout << "trade for ticker: " << m_tick_writer.loc_sym_from_uid(reqId) << "\n";
     }
 
-    m_tick_writer.addTrade(hft::ClockType::now(), price, size, exchange, m_tick_writer.loc_sym_from_uid(reqId)); 
+    hft::InstrumentId instrument = m_tick_writer.instrument_from_uid(reqId);
+    if(instrument == hft::NO_INSTRUMENT){
+        std::cerr << "trade for unknown request id " << reqId << "\n";
+        return;
+    }
+    const hft::TimePoint now = hft::ClockType::now();
+    m_tick_writer.addTrade(now, price, size, exchange.data(), exchange.size(), instrument); 
+    traceTick(instrument, now);
+    countTick(instrument, TICK_TRADE);
 }
 
 
@@ -230,7 +420,114 @@ void EminiLogger::tickByTickBidAsk(int reqId, time_t time, double bidPrice, doub
     }
 
     // store price info
-    m_tick_writer.addBidAsk(hft::ClockType::now(), bidPrice, askPrice, bidSize, askSize, m_tick_writer.loc_sym_from_uid(reqId));
+    hft::InstrumentId instrument = m_tick_writer.instrument_from_uid(reqId);
+    if(instrument == hft::NO_INSTRUMENT){
+        std::cerr << "quote for unknown request id " << reqId << "\n";
+        return;
+    }
+    const hft::TimePoint now = hft::ClockType::now();
+    m_tick_writer.addBidAsk(now, bidPrice, askPrice, bidSize, askSize, instrument);
+    traceTick(instrument, now);
+    countTick(instrument, TICK_BID_ASK);
+}
+
+
+void EminiLogger::traceTick(hft::InstrumentId instrument, const hft::TimePoint& callback)
+{
+    if(!m_latency)
+        return;
+
+    // the reader stamps with system_clock, which ClockType is with libstdc++
+    const std::int64_t at = sinceEpoch(callback);
+    if(m_pReader){
+        const EMessageTimes& times = m_pReader->messageTimes();
+        m_latency->record(hft::STAGE_FRAME, instrument, times.received, times.queued);
+        m_latency->record(hft::STAGE_QUEUE, instrument, times.queued, times.decoding);
+        m_latency->record(hft::STAGE_DECODE, instrument, times.decoding, at);
+    }
+    m_latency->record(hft::STAGE_ENQUEUE, instrument, at, sinceEpoch(hft::ClockType::now()));
+}
+
+
+void EminiLogger::countTick(hft::InstrumentId instrument, unsigned kind)
+{
+    if(m_metrics)
+        m_tick_counts[instrument * NUM_TICK_KINDS + kind]->add();
+}
+
+
+void EminiLogger::exportMetrics()
+{
+    // this thread is the only one that counts ticks
+    for(unsigned int i = 0; i < m_tick_writer.size(); ++i) {
+        for(unsigned kind = 0; kind < NUM_TICK_KINDS; ++kind)
+            m_tick_counts.push_back(&m_metrics->counter("ib_ticks_total", "Ticks handed to the tick writer.",
+                "instrument=\"" + m_tick_writer.loc_syms(i) + "\",type=\"" + TICK_KIND_NAMES[kind] + "\""));
+    }
+
+    // the rest is read from the tick writer's own counters when scraped
+    const hft::TickWriter& w = m_tick_writer;
+    m_metrics->gauge("ib_writer_queue_depth", "Rows waiting for the writer thread.", "",
+        [&w]() { return w.stats().queueDepth; }, this);
+    m_metrics->gauge("ib_writer_queue_capacity", "Rows the writer thread's queue holds.", "",
+        [&w]() { return w.stats().queueCapacity; }, this);
+    m_metrics->counter("ib_writer_rows_enqueued_total", "Rows queued for the writer thread.", "",
+        [&w]() { return w.stats().enqueued; }, this);
+    m_metrics->counter("ib_writer_rows_dropped_total", "Rows dropped because the writer thread's queue was full.", "",
+        [&w]() { return w.stats().dropped; }, this);
+    m_metrics->counter("ib_writer_stalls_total", "Times a row had to wait for room in the writer thread's queue.", "",
+        [&w]() { return w.stats().stalls; }, this);
+    m_metrics->counter("ib_writer_flushes_total", "Bundles written out.", "",
+        [&w]() { return w.stats().flushes; }, this);
+    m_metrics->histogram("ib_writer_flush_duration_seconds", "How long writing out a bundle took.", "",
+        w.flushLatency(), FLUSH_SECONDS, 1e-9, this);
+    m_metrics->histogram("ib_writer_bundle_rows", "Rows per bundle, written or spooled.", "",
+        w.bundleRows(), BUNDLE_ROWS, 1, this);
+    m_metrics->counter("ib_writer_unknown_symbols_total", "Exchanges and market makers written as \"?\" because the symbol table was full.", "",
+        [&w]() { return w.stats().unknownSymbols; }, this);
+    m_metrics->counter("ib_db_errors_total", "Failed database statements, reconnects and spool replays.", "",
+        [&w]() { return w.stats().dbErrors; }, this);
+    m_metrics->counter("ib_db_skipped_rows_total", "Rows the database ignored, e.g. duplicates.", "",
+        [&w]() { return w.stats().skippedRows; }, this);
+    m_metrics->counter("ib_db_warnings_total", "Other warnings from the database, e.g. truncated values.", "",
+        [&w]() { return w.stats().dbWarnings; }, this);
+    m_metrics->counter("ib_db_reconnects_total", "Times the writer reconnected to the database.", "",
+        [&w]() { return w.stats().reconnects; }, this);
+    m_metrics->counter("ib_db_reprepares_total", "Times the prepared statements were lost and prepared again.", "",
+        [&w]() { return w.stats().reprepares; }, this);
+    m_metrics->gauge("ib_db_spooling", "1 while the database is considered down and rows go to the spool.", "",
+        [&w]() { return w.stats().spooling ? 1 : 0; }, this);
+    m_metrics->counter("ib_spool_rows_total", "Rows written to the spool.", "",
+        [&w]() { return w.stats().spooledRows; }, this);
+    m_metrics->counter("ib_spool_replayed_rows_total", "Spooled rows replayed into the database.", "",
+        [&w]() { return w.stats().replayedRows; }, this);
+
+    if(m_latency) {
+        for(unsigned int i = 0; i < m_latency->instruments(); ++i) {
+            for(unsigned s = 0; s < hft::NUM_LATENCY_STAGES; ++s)
+                m_metrics->histogram("ib_tick_latency_seconds", "Time ticks spent in each stage (see IB_LATENCY_TRACE).",
+                    "instrument=\"" + m_tick_writer.loc_syms(i) + "\",stage=\"" + hft::LatencyTrace::stageName(s) + "\"",
+                    m_latency->histogram(static_cast<hft::LatencyStage>(s), i), TICK_SECONDS, 1e-9, this);
+        }
+    }
+}
+
+
+void EminiLogger::exportReaderMetrics()
+{
+    EReader* reader = m_pReader;
+    m_metrics->collect("ib_messages_received_total", "Messages read from the gateway, filtered or not, by msgId.",
+        hft::MetricsRegistry::COUNTER, [reader](std::vector<hft::Sample>& samples) {
+            for(int id = -1; id <= 255; ++id) {
+                const unsigned long long n = reader->messagesReceived(id);
+                if(n > 0)
+                    samples.push_back(hft::Sample {"msg_id=\"" + std::to_string(id) + "\"", static_cast<double>(n)});
+            }
+        }, this);
+    m_metrics->counter("ib_messages_skipped_total", "Messages dropped unread by the message filter.", "",
+        [reader]() { return reader->messagesSkipped(); }, this);
+    m_metrics->gauge("ib_reader_queue_depth", "Messages waiting to be decoded.", "",
+        [reader]() { return reader->queueDepth(); }, this);
 }
 
 
@@ -245,11 +542,21 @@ void EminiLogger::doNothing()
 void EminiLogger::marketRule(int marketRuleId, const std::vector<PriceIncrement> &priceIncrements) {}
 void EminiLogger::orderBound(long long orderId, int apiClientId, int apiOrderId) {}
 void EminiLogger::tickString(TickerId tickerId, TickType tickType, const std::string& value) {}
+void EminiLogger::tickString(TickerId tickerId, TickType tickType, EStringView value) {}
 void EminiLogger::currentTime( long time) {}
 void EminiLogger::familyCodes(const std::vector<FamilyCode> &familyCodes) {}
 void EminiLogger::newsArticle(int requestId, int articleType, const std::string& articleText) {}
 void EminiLogger::realtimeBar(TickerId reqId, long time, double open, double high, double low, 
-double close, long volume, double wap, int count) {}
+double close, long volume, double wap, int count) {
+    hft::InstrumentId instrument = m_tick_writer.instrument_from_uid(reqId);
+    if(instrument == hft::NO_INSTRUMENT){
+        std::cerr << "bar for unknown request id " << reqId << "\n";
+        return;
+    }
+    // stamped with when the bar starts, not when it arrived
+    m_tick_writer.addBar(hft::TimePoint(std::chrono::seconds(time)), open, high, low, close, volume, wap, count, instrument);
+    countTick(instrument, TICK_BAR);
+}
 void EminiLogger::tickGeneric(TickerId tickerId, TickType tickType, double value) {}
 void EminiLogger::scannerData(int reqId, int rank, const ContractDetails& contractDetails, const std::string& distance, const std::string& benchmark, const std::string& projection, const std::string& legsStr) {}
 void EminiLogger::scannerDataEnd(int reqId) {}
@@ -262,7 +569,9 @@ void EminiLogger::historicalData(TickerId reqId, const Bar& bar) {}
 void EminiLogger::historicalNews(int requestId, const std::string& time, const std::string& providerCode, const std::string& articleId, const std::string& headline) {}
 void EminiLogger::headTimestamp(int reqId, const std::string& headTimestamp) {}
 void EminiLogger::marketDataType(TickerId reqId, int marketDataType) {}
-void EminiLogger::updateMktDepth(TickerId id, int position, int operation, int side, double price, int size) {}
+void EminiLogger::updateMktDepth(TickerId id, int position, int operation, int side, double price, int size) {
+    updateMktDepthL2(id, position, EStringView(), operation, side, price, size, false);
+}
 void EminiLogger::contractDetails( int reqId, const ContractDetails& contractDetails) {}
 void EminiLogger::fundamentalData(TickerId reqId, const std::string& data) {}
 void EminiLogger::historicalTicks(int reqId, const std::vector<HistoricalTick>& ticks, bool done) {}
@@ -278,7 +587,22 @@ void EminiLogger::historicalDataEnd(int reqId, const std::string& startDateStr,
 void EminiLogger::historicalNewsEnd(int requestId, bool hasMore) {}
 void EminiLogger::mktDepthExchanges(const std::vector<DepthMktDataDescription> &depthMktDataDescriptions) {}
 void EminiLogger::updateMktDepthL2(TickerId id, int position, const std::string& marketMaker, int operation,
-                                     int side, double price, int size, bool isSmartDepth) {}
+                                     int side, double price, int size, bool isSmartDepth) {
+    updateMktDepthL2(id, position, EStringView(marketMaker.c_str(), marketMaker.size()), operation, side, price, size, isSmartDepth);
+}
+void EminiLogger::updateMktDepthL2(TickerId id, int position, EStringView marketMaker, int operation,
+                                     int side, double price, int size, bool isSmartDepth) {
+    hft::InstrumentId instrument = m_tick_writer.instrument_from_uid(id);
+    if(instrument == hft::NO_INSTRUMENT){
+        std::cerr << "depth for unknown request id " << id << "\n";
+        return;
+    }
+    const hft::TimePoint now = hft::ClockType::now();
+    m_tick_writer.addDepth(now, position, operation, side, price, size, 
+                           marketMaker.data(), marketMaker.size(), instrument);
+    traceTick(instrument, now);
+    countTick(instrument, TICK_DEPTH);
+}
 void EminiLogger::rerouteMktDataReq(int reqId, int conid, const std::string& exchange) {}
 void EminiLogger::scannerParameters(const std::string& xml) {}
 void EminiLogger::updateAccountTime(const std::string& timeStamp) {}
@@ -286,7 +610,17 @@ void EminiLogger::accountDownloadEnd(const std::string& accountName) {}
 void EminiLogger::accountUpdateMulti( int reqId, const std::string& account, const std::string& modelCode, const std::string& key, const std::string& value, const std::string& currency) {}
 void EminiLogger::contractDetailsEnd( int reqId) {}
 void EminiLogger::rerouteMktDepthReq(int reqId, int conid, const std::string& exchange) {}
-void EminiLogger::tickByTickMidPoint(int reqId, time_t time, double midPoint) {}
+void EminiLogger::tickByTickMidPoint(int reqId, time_t time, double midPoint) {
+    hft::InstrumentId instrument = m_tick_writer.instrument_from_uid(reqId);
+    if(instrument == hft::NO_INSTRUMENT){
+        std::cerr << "mid point for unknown request id " << reqId << "\n";
+        return;
+    }
+    const hft::TimePoint now = hft::ClockType::now();
+    m_tick_writer.addMidPoint(now, midPoint, instrument);
+    traceTick(instrument, now);
+    countTick(instrument, TICK_MID_POINT);
+}
 void EminiLogger::updateNewsBulletin(int msgId, int msgType, const std::string& newsMessage, const std::string& originExch) {}
 void EminiLogger::bondContractDetails( int reqId, const ContractDetails& contractDetails) {}
 void EminiLogger::displayGroupUpdated( int reqId, const std::string& contractInfo) {}
@@ -6,6 +6,7 @@
 #define TWS_API_SAMPLES_TESTCPPCLIENT_TESTCPPCLIENT_H
 
 #include "EWrapper.h"
+#include "EViewWrapper.h"
 #include "EReaderOSSignal.h"
 #include "EReader.h"
 
@@ -15,6 +16,7 @@
 // my stuff
 #include "config.h"
 #include "tick_writer.h"
+#include "metrics.h"
 
 class EClientSocket;
 
@@ -28,18 +30,24 @@ enum State {
     ST_UNSUBSCRIBE_ACK
 };
 
-class EminiLogger : public EWrapper
+class EminiLogger : public EWrapper, public EViewWrapper
 {
 private:
 
 public:
 
-	EminiLogger();
+	// metrics, if given, gets the reader's, the tick writer's and the
+	// tick counts, for as long as this logger lives
+	explicit EminiLogger(hft::MetricsRegistry* metrics = nullptr);
 	~EminiLogger();
 
 	void setConnectOptions(const std::string&);
 	void processMessages();
 
+	// decodes a capture (see IB_CAPTURE) into the tick writer instead
+	// of connecting; paced keeps the gaps the messages came in with
+	bool replay(const char * path, bool paced);
+
 public:
 
 	bool connect(const char * host, int port, int clientId = 0);
@@ -50,10 +58,20 @@ private:
     void reqAllData();
     void doNothing();
     void unsubscribeAll();
+    Contract contract(unsigned int idx) const;
+    void traceTick(hft::InstrumentId instrument, const hft::TimePoint& callback);
+    void countTick(hft::InstrumentId instrument, unsigned kind);
+    void exportMetrics();
+    void exportReaderMetrics();
 public:
 	// events
 	#include "EWrapper_prototypes.h"
 
+	// the same callbacks, without copying text out of the message
+	void tickByTickAllLast(int reqId, int tickType, time_t time, double price, int size, const TickAttribLast& tickAttribLast, EStringView exchange, EStringView specialConditions);
+	void tickString(TickerId tickerId, TickType tickType, EStringView value);
+	void updateMktDepthL2(TickerId id, int position, EStringView marketMaker, int operation, int side, double price, int size, bool isSmartDepth);
+
 private:
 	EReaderOSSignal m_osSignal;
 	EClientSocket * const m_pClient;
@@ -65,8 +83,20 @@ private:
 
     // new stuff! 
     const bool m_printing;
+
+    // per stage latency of every tick (null with IB_LATENCY_TRACE=0),
+    // printed every m_latency_dump_s seconds; outlives the tick
+    // writer, whose thread records into it
+    std::unique_ptr<hft::LatencyTrace> m_latency;
+    unsigned m_latency_dump_s;
+    hft::TimePoint m_last_latency_dump;
+
     hft::TickWriter m_tick_writer;
 
+    // ib_ticks_total of each instrument and TickKind, if there are metrics
+    hft::MetricsRegistry* const m_metrics;
+    std::vector<hft::Counter*> m_tick_counts;
+
 };
 
 #endif
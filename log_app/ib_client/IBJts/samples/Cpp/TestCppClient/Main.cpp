@@ -7,6 +7,8 @@
 #include <stdlib.h>
 #include <cstdlib> // std::getenv
 #include <chrono>
+#include <memory>
+#include <stdexcept>
 #include <thread>
 
 #include "EminiLogger.h"
@@ -24,14 +26,40 @@ int main(int argc, char** argv)
 	const char* connectOptions = argc > 3 ? argv[3] : "";
 	int clientId = 0;
 
+	// Prometheus metrics on IB_METRICS_ADDR:IB_METRICS_PORT (127.0.0.1:9464
+	// by default); IB_METRICS_PORT=0 turns them off
+	hft::MetricsRegistry metrics;
+	std::unique_ptr<hft::MetricsServer> metricsServer;
+	const char* metricsPort = std::getenv("IB_METRICS_PORT");
+	const char* metricsAddr = std::getenv("IB_METRICS_ADDR");
+	int mport = metricsPort ? atoi(metricsPort) : 9464;
+	if (mport > 0) {
+		try {
+			metricsServer.reset(new hft::MetricsServer(metrics, metricsAddr ? metricsAddr : "127.0.0.1", mport));
+		} catch (const std::exception& e) {
+			printf( "%s, running without metrics\n", e.what());
+		}
+	}
+	hft::Counter& attempts = metrics.counter("ib_gateway_connection_attempts_total", "Times the logger (re)connected to the gateway.");
+
+	// IB_REPLAY=file decodes a capture (see IB_CAPTURE) instead of connecting,
+	// as fast as it can, or as it was received with IB_REPLAY_PACED=1
+	const char* replay = std::getenv("IB_REPLAY");
+	if (replay) {
+		const char* paced = std::getenv("IB_REPLAY_PACED");
+		EminiLogger client(&metrics);
+		return client.replay(replay, paced && atoi(paced)) ? 0 : 1;
+	}
+
 	unsigned attempt = 0;
 	printf( "Start of C++ Socket Client Test %u\n", attempt);
 
 	for (;;) {
 		++attempt;
 		printf( "Attempt %u of %u\n", attempt, MAX_ATTEMPTS);
+		attempts.add();
 
-		EminiLogger client;
+		EminiLogger client(&metrics);
 
 		// Run time error will occur (here) if TestCppClient.exe is compiled in debug mode but TwsSocketClient.dll is compiled in Release mode
 		// TwsSocketClient.dll (in Release Mode) is copied by API installer into SysWOW64 folder within Windows directory 
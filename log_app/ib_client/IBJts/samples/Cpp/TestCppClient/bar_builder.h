@@ -0,0 +1,138 @@
+#ifndef BAR_BUILDER_H
+#define BAR_BUILDER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+namespace hft {
+
+
+/**
+ * @struct TradeBar
+ * @brief open/high/low/close/volume/VWAP/trade count of the trades
+ * of one instrument during one interval
+ */
+struct TradeBar {
+    std::int64_t start; // nanoseconds since the epoch, a multiple of the interval
+    double open;
+    double high;
+    double low;
+    double close;
+    std::int64_t volume;
+    double notional;    // sum of price * size, for the VWAP
+    std::int64_t count;
+
+    double vwap() const { return volume > 0 ? notional / volume : close; }
+};
+
+
+/**
+ * @class BarBuilder
+ * @brief folds trades into bars of one interval, one bar in the
+ * making per instrument
+ *
+ * A bar is finished by the first trade of a later interval, or by
+ * advance() once its interval is over, whichever comes first, and
+ * then handed to the emit callback. Intervals without trades make
+ * no bar. The state is a fixed array, so nothing allocates after
+ * the constructor.
+ */
+class BarBuilder {
+public:
+
+    BarBuilder(unsigned intervalSeconds, unsigned instruments)
+        : m_interval(intervalSeconds * 1000000000LL)
+        , m_seconds(intervalSeconds)
+        , m_bars(instruments)
+    {
+        for(TradeBar& bar : m_bars)
+            bar.count = 0;
+    }
+
+
+    /**
+     * @brief adds one trade; emit(instrument, bar) gets the bar it
+     * finished, if any
+     */
+    template<typename Emit>
+    void trade(unsigned instrument, std::int64_t nanos, double price, int size, Emit emit) {
+        TradeBar& bar = m_bars[instrument];
+        const std::int64_t start = nanos - nanos % m_interval;
+
+        if(bar.count > 0 && bar.start != start) {
+            emit(instrument, bar);
+            bar.count = 0;
+        }
+
+        if(bar.count == 0) {
+            bar.start = start;
+            bar.open = bar.high = bar.low = price;
+            bar.volume = 0;
+            bar.notional = 0;
+        } else if(price > bar.high) {
+            bar.high = price;
+        } else if(price < bar.low) {
+            bar.low = price;
+        }
+        bar.close = price;
+        bar.volume += size;
+        bar.notional += price * size;
+        bar.count++;
+    }
+
+
+    /**
+     * @brief finishes every bar whose interval is over by nanos
+     */
+    template<typename Emit>
+    void advance(std::int64_t nanos, Emit emit) {
+        for(unsigned instrument = 0; instrument < m_bars.size(); ++instrument) {
+            TradeBar& bar = m_bars[instrument];
+            if(bar.count > 0 && nanos >= bar.start + m_interval) {
+                emit(instrument, bar);
+                bar.count = 0;
+            }
+        }
+    }
+
+
+    /**
+     * @brief finishes one instrument's bar if its interval is over by nanos
+     */
+    template<typename Emit>
+    void advance(unsigned instrument, std::int64_t nanos, Emit emit) {
+        TradeBar& bar = m_bars[instrument];
+        if(bar.count > 0 && nanos >= bar.start + m_interval) {
+            emit(instrument, bar);
+            bar.count = 0;
+        }
+    }
+
+
+    unsigned intervalSeconds() const { return m_seconds; }
+
+
+    /**
+     * @brief "1s", "5m", "1h", ... for table names
+     */
+    static std::string label(unsigned seconds) {
+        if(seconds % 3600 == 0)
+            return std::to_string(seconds / 3600) + "h";
+        if(seconds % 60 == 0)
+            return std::to_string(seconds / 60) + "m";
+        return std::to_string(seconds) + "s";
+    }
+
+private:
+
+    std::int64_t m_interval; // nanoseconds
+    unsigned m_seconds;
+    std::vector<TradeBar> m_bars; // indexed by instrument
+};
+
+
+} // namespace hft
+
+#endif // BAR_BUILDER_H
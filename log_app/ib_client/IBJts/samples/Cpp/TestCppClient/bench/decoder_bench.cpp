@@ -0,0 +1,198 @@
+/*
+ * decodes tick-by-tick messages with EDecoder, and compares its numeric
+ * field parsing with the FindFieldEnd + atoi/atof parsing it replaced
+ *
+ * usage: ./decoder_bench [passes] [recorded messages]
+ *
+ * The recording is what the gateway sends after the handshake: each
+ * message is a 4-byte big-endian length followed by its fields. Without
+ * one, bid/ask and last ticks in the shape ES trades at are generated.
+ */
+#include "StdAfx.h"
+#include "EDecoder.h"
+#include "DefaultEWrapper.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+using BenchClock = std::chrono::steady_clock;
+
+
+/* adds up what the decoder hands over, so none of it is optimised away */
+class SumWrapper : public DefaultEWrapper {
+public:
+    double sum = 0;
+    long ticks = 0;
+
+    void tickByTickAllLast(int reqId, int tickType, time_t time, double price, int size,
+                           const TickAttribLast&, const std::string&, const std::string&) override {
+        sum += reqId + tickType + time + price + size;
+        ++ticks;
+    }
+    void tickByTickBidAsk(int reqId, time_t time, double bidPrice, double askPrice,
+                          int bidSize, int askSize, const TickAttribBidAsk&) override {
+        sum += reqId + time + bidPrice + askPrice + bidSize + askSize;
+        ++ticks;
+    }
+    void tickByTickMidPoint(int reqId, time_t time, double midPoint) override {
+        sum += reqId + time + midPoint;
+        ++ticks;
+    }
+};
+
+
+static void addField(std::string& msg, const std::string& field) {
+    msg += field;
+    msg.push_back('\0');
+}
+
+
+static std::vector<std::string> generate(long count) {
+    std::vector<std::string> msgs;
+    long t = 1600000000;
+    double price = 3350.25;
+    for(long i = 0; i < count; ++i) {
+        std::string msg;
+        addField(msg, std::to_string(TICK_BY_TICK));
+        addField(msg, std::to_string(4000 + i % 8));
+        t += (i % 50 == 0);
+        price += (i % 7 == 0) ? 0.25 : (i % 11 == 0) ? -0.25 : 0;
+        char bid[32], ask[32];
+        std::snprintf(bid, sizeof(bid), "%.2f", price);
+        std::snprintf(ask, sizeof(ask), "%.2f", price + 0.25);
+        if( i % 4 == 0 ) {
+            addField(msg, "1");
+            addField(msg, std::to_string(t));
+            addField(msg, bid);
+            addField(msg, std::to_string(1 + i % 17));
+            addField(msg, "0");
+            addField(msg, "CME");
+            addField(msg, "");
+        } else {
+            addField(msg, "3");
+            addField(msg, std::to_string(t));
+            addField(msg, bid);
+            addField(msg, ask);
+            addField(msg, std::to_string(10 + i % 90));
+            addField(msg, std::to_string(5 + i % 60));
+            addField(msg, "0");
+        }
+        msgs.push_back(msg);
+    }
+    return msgs;
+}
+
+
+static std::vector<std::string> load(const char* path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<std::string> msgs;
+    std::size_t pos = 0;
+    while(pos + 4 <= bytes.size()) {
+        std::uint32_t len;
+        std::memcpy(&len, bytes.data() + pos, 4);
+        len = ntohl(len);
+        if( pos + 4 + len > bytes.size() )
+            break;
+        msgs.push_back(bytes.substr(pos + 4, len));
+        pos += 4 + len;
+    }
+    return msgs;
+}
+
+
+/* what EDecoder::DecodeField used to do for numbers */
+static bool legacyField(const char*& ptr, const char* endPtr, double& value, bool isInt) {
+    const char* fieldEnd = (const char*)std::memchr(ptr, 0, endPtr - ptr);
+    if( !fieldEnd )
+        return false;
+    value = isInt ? std::atoll(ptr) : std::atof(ptr);
+    ptr = fieldEnd + 1;
+    return true;
+}
+
+
+/* numeric fields only, one type per field like processTickByTickDataMsg */
+static double fields(const std::vector<std::string>& msgs, bool legacy) {
+    double sum = 0;
+    for(const std::string& msg : msgs) {
+        const char* ptr = msg.data();
+        const char* endPtr = ptr + msg.size();
+        int msgId, reqId, tickType;
+        if( !EDecoder::DecodeField(msgId, ptr, endPtr) || msgId != TICK_BY_TICK )
+            continue;
+        EDecoder::DecodeField(reqId, ptr, endPtr);
+        EDecoder::DecodeField(tickType, ptr, endPtr);
+        // time, then prices and sizes; exchange and conditions are strings
+        static const bool bidAsk[] = { true, false, false, true, true, true };
+        static const bool last[]   = { true, false, true, true };
+        const bool* isInt = tickType == 3 ? bidAsk : last;
+        const int n = tickType == 3 ? 6 : 4;
+        for(int f = 0; f < n; ++f) {
+            double v = 0;
+            if( legacy ) {
+                legacyField(ptr, endPtr, v, isInt[f]);
+            } else if( isInt[f] ) {
+                long long l = 0;
+                EDecoder::DecodeField(l, ptr, endPtr);
+                v = l;
+            } else {
+                EDecoder::DecodeField(v, ptr, endPtr);
+            }
+            sum += v;
+        }
+    }
+    return sum;
+}
+
+
+int main(int argc, char** argv)
+{
+    const long passes = argc > 1 ? std::atol(argv[1]) : 20;
+    const std::vector<std::string> msgs = argc > 2 ? load(argv[2]) : generate(200000);
+    if( msgs.empty() ) {
+        std::fprintf(stderr, "no messages\n");
+        return 1;
+    }
+
+    double checksum = 0;
+
+    BenchClock::time_point t0 = BenchClock::now();
+    for(long p = 0; p < passes; ++p)
+        checksum += fields(msgs, true);
+    BenchClock::time_point t1 = BenchClock::now();
+    for(long p = 0; p < passes; ++p)
+        checksum += fields(msgs, false);
+    BenchClock::time_point t2 = BenchClock::now();
+
+    SumWrapper wrapper;
+    EDecoder decoder(MIN_SERVER_VER_TICK_BY_TICK, &wrapper);
+    for(long p = 0; p < passes; ++p) {
+        for(const std::string& msg : msgs) {
+            const char* ptr = msg.data();
+            decoder.parseAndProcessMsg(ptr, ptr + msg.size());
+        }
+    }
+    BenchClock::time_point t3 = BenchClock::now();
+    checksum += wrapper.sum;
+
+    const double calls = static_cast<double>(passes) * msgs.size();
+    auto per_msg = [calls](BenchClock::time_point a, BenchClock::time_point b) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count() / calls;
+    };
+    std::printf("%zu messages x %ld passes (%ld ticks decoded)\n", msgs.size(), passes, wrapper.ticks);
+    std::printf("numeric fields, memchr + atoi/atof  %8.1f ns/msg\n", per_msg(t0, t1));
+    std::printf("numeric fields, DecodeField         %8.1f ns/msg\n", per_msg(t1, t2));
+    std::printf("parseAndProcessMsg                  %8.1f ns/msg\n", per_msg(t2, t3));
+    std::printf("(checksum %g)\n", checksum);
+    return 0;
+}
@@ -0,0 +1,478 @@
+/*
+ * times the steps a tick goes through on its way to the database, one
+ * case per step, so a change to the decoder, the reader or the writer
+ * can be checked for what it does to each of them
+ *
+ * usage: ./hot_path_bench [-r repeats] [-b baseline.jsonl]
+ *                         [-m mysql_config.txt tickers.txt]
+ *
+ *   -r  runs of every case; the median and the fastest are kept (5)
+ *   -b  an earlier run's output, to compare against on stderr
+ *   -m  also time TickWriter::addTrade and flushToDB against the
+ *       database in the config (asyncWriter is turned off, so the
+ *       flushes happen on the calling thread)
+ *
+ * Prints one JSON object per case and line on stdout:
+ *
+ *   {"case": "tbt_last", "ops": 200000, "ns_per_op": 61.2, "min_ns_per_op": 60.4}
+ *
+ * Keep a run's output, and pass it as -b to the next one:
+ *
+ *   ./bench/hot_path_bench > before.jsonl
+ *   ... change something, make bench ...
+ *   ./bench/hot_path_bench -b before.jsonl > after.jsonl
+ */
+#include "StdAfx.h"
+#include "EDecoder.h"
+#include "EClientSocket.h"
+#include "EReader.h"
+#include "EReaderOSSignal.h"
+#include "EViewWrapper.h"
+#include "DefaultEWrapper.h"
+
+#include "config.h"
+#include "tick_writer.h"
+#include "timestamp.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using BenchClock = std::chrono::steady_clock;
+
+
+/* adds up what the decoder hands over, so none of it is optimised away */
+class SumWrapper : public DefaultEWrapper, public EViewWrapper {
+public:
+    double sum = 0;
+    long ticks = 0;
+
+    void tickByTickAllLast(int reqId, int tickType, time_t time, double price, int size,
+                           const TickAttribLast&, const std::string& exchange, const std::string&) override {
+        sum += reqId + tickType + time + price + size + exchange.size();
+        ++ticks;
+    }
+    void tickByTickAllLast(int reqId, int tickType, time_t time, double price, int size,
+                           const TickAttribLast&, EStringView exchange, EStringView) override {
+        sum += reqId + tickType + time + price + size + exchange.size();
+        ++ticks;
+    }
+    void tickByTickBidAsk(int reqId, time_t time, double bidPrice, double askPrice,
+                          int bidSize, int askSize, const TickAttribBidAsk&) override {
+        sum += reqId + time + bidPrice + askPrice + bidSize + askSize;
+        ++ticks;
+    }
+    void tickString(TickerId, TickType, EStringView) override {}
+    void updateMktDepthL2(TickerId, int, EStringView, int, int, double, int, bool) override {}
+};
+
+
+/* ---------------------------------------------------------------- */
+/* messages                                                         */
+/* ---------------------------------------------------------------- */
+
+
+static void addField(std::string& msg, const std::string& field) {
+    msg += field;
+    msg.push_back('\0');
+}
+
+
+static std::string price(double p) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.2f", p);
+    return buf;
+}
+
+
+/* tick-by-tick trades (tickType 1) or quotes (3) in the shape ES trades at */
+static std::vector<std::string> tickByTick(long count, int tickType) {
+    std::vector<std::string> msgs;
+    long t = 1600000000;
+    double px = 3350.25;
+    for(long i = 0; i < count; ++i) {
+        std::string msg;
+        addField(msg, std::to_string(TICK_BY_TICK));
+        addField(msg, std::to_string(4000 + i % 8));
+        addField(msg, std::to_string(tickType));
+        t += (i % 50 == 0);
+        px += (i % 7 == 0) ? 0.25 : (i % 11 == 0) ? -0.25 : 0;
+        addField(msg, std::to_string(t));
+        if( tickType == 3 ) {
+            addField(msg, price(px));
+            addField(msg, price(px + 0.25));
+            addField(msg, std::to_string(10 + i % 90));
+            addField(msg, std::to_string(5 + i % 60));
+            addField(msg, "0");
+        } else {
+            addField(msg, price(px));
+            addField(msg, std::to_string(1 + i % 17));
+            addField(msg, "0");
+            addField(msg, "CME");
+            addField(msg, "");
+        }
+        msgs.push_back(msg);
+    }
+    return msgs;
+}
+
+
+/* the messages as the gateway sends them: a 4-byte big-endian length, then the fields */
+static std::string stream(const std::vector<std::string>& msgs) {
+    std::string bytes;
+    for(const std::string& msg : msgs) {
+        std::uint32_t len = htonl(static_cast<std::uint32_t>(msg.size()));
+        bytes.append(reinterpret_cast<const char*>(&len), 4);
+        bytes += msg;
+    }
+    return bytes;
+}
+
+
+/* count fields of one kind, back to back */
+static std::string fields(long count, const std::function<std::string(long)>& make) {
+    std::string buf;
+    for(long i = 0; i < count; ++i)
+        addField(buf, make(i));
+    return buf;
+}
+
+
+/* ---------------------------------------------------------------- */
+/* cases                                                            */
+/* ---------------------------------------------------------------- */
+
+
+struct Case {
+    std::string name;
+    long ops;                      // what one run does, for ns/op
+    std::function<double()> run;   // returns a checksum
+    std::function<void()> setup;   // before each run, not timed
+};
+
+
+template<typename T>
+static double decodeFields(const std::string& buf) {
+    double sum = 0;
+    const char* ptr = buf.data();
+    const char* endPtr = ptr + buf.size();
+    T value;
+    while(ptr < endPtr && EDecoder::DecodeField(value, ptr, endPtr))
+        sum += static_cast<double>(sizeof(value));
+    return sum;
+}
+
+
+static double decodeMessages(const std::vector<std::string>& msgs, bool views) {
+    SumWrapper wrapper;
+    EDecoder decoder(MIN_SERVER_VER_TICK_BY_TICK, &wrapper);
+    if( views )
+        decoder.setViewWrapper(&wrapper);
+    for(const std::string& msg : msgs) {
+        const char* ptr = msg.data();
+        decoder.parseAndProcessMsg(ptr, ptr + msg.size());
+    }
+    return wrapper.sum;
+}
+
+
+/*
+ * The reader gets bytes over a loopback socket from a thread playing
+ * the gateway: the handshake, then the whole stream at once. With
+ * decode off the filter drops every tick as soon as it is framed, so
+ * what's left is reading and framing.
+ */
+static double readerLoopback(const std::string& bytes, bool decode) {
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addrLen = sizeof(addr);
+    if( ::bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0
+        || ::listen(listener, 1) < 0
+        || ::getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &addrLen) < 0 ) {
+        ::close(listener);
+        return 0;
+    }
+
+    std::thread gateway([listener, &bytes]() {
+        int fd = ::accept(listener, 0, 0);
+        if( fd < 0 )
+            return;
+        // "API\0", the client's versions, then startApi once it has ours
+        auto readFrame = [fd]() {
+            std::uint32_t len = 0;
+            if( ::recv(fd, &len, 4, MSG_WAITALL) != 4 )
+                return false;
+            std::string body(ntohl(len), '\0');
+            return body.empty() || ::recv(fd, &body[0], body.size(), MSG_WAITALL) == static_cast<ssize_t>(body.size());
+        };
+        char api[4];
+        std::string version;
+        addField(version, std::to_string(MIN_SERVER_VER_TICK_BY_TICK));
+        addField(version, "20200101 00:00:00 UTC");
+        std::vector<std::string> hello(1, version);
+        std::string helloBytes = stream(hello);
+        if( ::recv(fd, api, 4, MSG_WAITALL) == 4 && readFrame()
+            && ::send(fd, helloBytes.data(), helloBytes.size(), MSG_NOSIGNAL) > 0 && readFrame() ) {
+            std::size_t sent = 0;
+            while(sent < bytes.size()) {
+                ssize_t n = ::send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+                if( n <= 0 )
+                    break;
+                sent += n;
+            }
+        }
+        ::close(fd);
+    });
+
+    SumWrapper wrapper;
+    EReaderOSSignal signal(100);
+    EClientSocket client(&wrapper, &signal);
+    double sum = 0;
+    if( client.eConnect("127.0.0.1", ntohs(addr.sin_port), 0) ) {
+        EReader reader(&client, &signal);
+        if( !decode ) {
+            EMessageFilter filter;
+            filter.wantNone();
+            reader.setMessageFilter(filter);
+        }
+        reader.start();
+        while(client.isConnected()) {
+            signal.waitForSignal();
+            reader.processMsgs();
+        }
+        sum = wrapper.sum + reader.messagesSkipped();
+    } else {
+        ::shutdown(listener, SHUT_RDWR); // so accept() gives up
+    }
+    gateway.join();
+    ::close(listener);
+    return sum;
+}
+
+
+static std::string tempFile(const std::string& contents) {
+    char path[] = "/tmp/hot_path_bench_XXXXXX";
+    int fd = ::mkstemp(path);
+    if( fd < 0 )
+        return "";
+    ::close(fd);
+    std::ofstream out(path);
+    out << contents;
+    return path;
+}
+
+
+static const char* TICKERS =
+    "MES,FUT,GLOBEX,MESH1,.25,.47,5,0,1,USD,Last BidAsk\n"
+    "MNQ,FUT,GLOBEX,MNQH1,.25,.47,2,0,1,USD,Last BidAsk\n"
+    "M2K,FUT,GLOBEX,M2KH1,.25,.47,5,0,1,USD,Last BidAsk\n"
+    "MYM,FUT,ECBOT,MYMH1,1,.47,5,0,1,USD,Last BidAsk\n";
+
+
+/* ---------------------------------------------------------------- */
+/* running and reporting                                            */
+/* ---------------------------------------------------------------- */
+
+
+struct Result {
+    double median;
+    double fastest;
+};
+
+
+static Result measure(const Case& c, int repeats, double& checksum) {
+    std::vector<double> runs;
+    for(int r = 0; r < repeats; ++r) {
+        if( c.setup )
+            c.setup();
+        BenchClock::time_point t0 = BenchClock::now();
+        checksum += c.run();
+        BenchClock::time_point t1 = BenchClock::now();
+        runs.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / c.ops);
+    }
+    std::sort(runs.begin(), runs.end());
+    Result result;
+    result.median = runs[runs.size() / 2];
+    result.fastest = runs.front();
+    return result;
+}
+
+
+/* ns/op per case of an earlier run's output */
+static std::map<std::string, double> loadBaseline(const char* path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while(std::getline(in, line)) {
+        char name[128];
+        long ops;
+        double ns;
+        if( std::sscanf(line.c_str(), "{\"case\": \"%127[^\"]\", \"ops\": %ld, \"ns_per_op\": %lf", name, &ops, &ns) == 3 )
+            baseline[name] = ns;
+    }
+    return baseline;
+}
+
+
+/* one JSON line per case on stdout; the comparison with the baseline on stderr */
+static double report(const std::vector<Case>& cases, int repeats, const std::map<std::string, double>& baseline) {
+    double checksum = 0;
+    for(const Case& c : cases) {
+        Result r = measure(c, repeats, checksum);
+        std::printf("{\"case\": \"%s\", \"ops\": %ld, \"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f}\n",
+                    c.name.c_str(), c.ops, r.median, r.fastest);
+        std::fflush(stdout);
+
+        std::map<std::string, double>::const_iterator before = baseline.find(c.name);
+        if( before != baseline.end() && before->second > 0 )
+            std::fprintf(stderr, "%-30s %12.2f ns/op, was %12.2f (%+.1f%%)\n", c.name.c_str(), r.median,
+                         before->second, 100.0 * (r.median - before->second) / before->second);
+    }
+    return checksum;
+}
+
+
+int main(int argc, char** argv)
+{
+    int repeats = 5;
+    const char* baselinePath = 0;
+    const char* mysqlConfig = 0;
+    const char* tickers = 0;
+    int opt;
+    while((opt = ::getopt(argc, argv, "r:b:m:")) != -1) {
+        switch(opt) {
+        case 'r': repeats = std::max(1, std::atoi(optarg)); break;
+        case 'b': baselinePath = optarg; break;
+        case 'm':
+            mysqlConfig = optarg;
+            if( optind < argc )
+                tickers = argv[optind++];
+            break;
+        default:
+            std::fprintf(stderr, "usage: %s [-r repeats] [-b baseline.jsonl] [-m mysql_config.txt tickers.txt]\n", argv[0]);
+            return 1;
+        }
+    }
+    if( mysqlConfig && !tickers ) {
+        std::fprintf(stderr, "-m needs a mysql config and a tickers file\n");
+        return 1;
+    }
+
+    std::vector<Case> cases;
+
+    // DecodeField, one type at a time
+    const long N = 1000000;
+    const std::string ints = fields(N, [](long i) { return std::to_string(i % 100000); });
+    const std::string longs = fields(N, [](long i) { return std::to_string(1600000000L + i); });
+    const std::string doubles = fields(N, [](long i) { return price(3350.25 + (i % 400) * 0.25); });
+    const std::string strings = fields(N, [](long i) { return i % 3 ? "CME" : "GLOBEX"; });
+    const std::string bools = fields(N, [](long i) { return i % 2 ? "1" : "0"; });
+    cases.push_back(Case{"decode_field_int", N, [&ints]() { return decodeFields<int>(ints); }});
+    cases.push_back(Case{"decode_field_long_long", N, [&longs]() { return decodeFields<long long>(longs); }});
+    cases.push_back(Case{"decode_field_double", N, [&doubles]() { return decodeFields<double>(doubles); }});
+    cases.push_back(Case{"decode_field_string", N, [&strings]() { return decodeFields<std::string>(strings); }});
+    cases.push_back(Case{"decode_field_view", N, [&strings]() { return decodeFields<EStringView>(strings); }});
+    cases.push_back(Case{"decode_field_bool", N, [&bools]() { return decodeFields<bool>(bools); }});
+
+    // processTickByTickDataMsg, through parseAndProcessMsg
+    const long M = 200000;
+    const std::vector<std::string> lasts = tickByTick(M, 1);
+    const std::vector<std::string> quotes = tickByTick(M, 3);
+    cases.push_back(Case{"tbt_last", M, [&lasts]() { return decodeMessages(lasts, false); }});
+    cases.push_back(Case{"tbt_last_view", M, [&lasts]() { return decodeMessages(lasts, true); }});
+    cases.push_back(Case{"tbt_bid_ask", M, [&quotes]() { return decodeMessages(quotes, false); }});
+
+    // EReader over loopback
+    std::vector<std::string> mixed(quotes.begin(), quotes.end());
+    for(long i = 0; i < M; i += 4)
+        mixed[i] = lasts[i];
+    const std::string bytes = stream(mixed);
+    cases.push_back(Case{"ereader_framing", M, [&bytes]() { return readerLoopback(bytes, false); }});
+    cases.push_back(Case{"ereader_decode", M, [&bytes]() { return readerLoopback(bytes, true); }});
+
+    // timestamps, and the string TickWriter's toString() makes of them
+    const std::int64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch()).count();
+    cases.push_back(Case{"format_timestamp", N, [start]() {
+        char out[hft::TIMESTAMP_LEN];
+        double sum = 0;
+        for(long i = 0; i < N; ++i)
+            sum += hft::formatTimestamp(out, start + i * 50000) + out[25];
+        return sum;
+    }});
+    cases.push_back(Case{"timestamp_to_string", N, [start]() {
+        char out[hft::TIMESTAMP_LEN];
+        double sum = 0;
+        for(long i = 0; i < N; ++i)
+            sum += std::string(out, hft::formatTimestamp(out, start + i * 50000)).size();
+        return sum;
+    }});
+
+    // request id lookups, once per tick
+    const std::string tickersPath = tempFile(TICKERS);
+    const hft::FutSymsConfig config(tickersPath);
+    ::unlink(tickersPath.c_str());
+    const unsigned firstUid = config.request_id(0, hft::STREAM_LAST);
+    const unsigned uids = config.size() * hft::NUM_STREAMS;
+    cases.push_back(Case{"loc_sym_from_uid", N, [&config, firstUid, uids]() {
+        double sum = 0;
+        for(long i = 0; i < N; ++i)
+            sum += config.loc_sym_from_uid(firstUid + i % uids).size();
+        return sum;
+    }});
+    cases.push_back(Case{"instrument_from_uid", N, [&config, firstUid, uids]() {
+        double sum = 0;
+        for(long i = 0; i < N; ++i)
+            sum += config.instrument_from_uid(firstUid + i % uids);
+        return sum;
+    }});
+
+    const std::map<std::string, double> baseline = baselinePath ? loadBaseline(baselinePath) : std::map<std::string, double>();
+    double checksum = report(cases, repeats, baseline);
+
+    // the writer, against a real database
+    if( mysqlConfig ) {
+        std::ifstream in(mysqlConfig);
+        std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        // a later line wins over an earlier one
+        const std::string syncConfig = tempFile(contents + "\nasyncWriter=0\n");
+        hft::TickWriter w(syncConfig, tickers);
+        ::unlink(syncConfig.c_str());
+
+        const long TRADES = 1000;
+        auto addTrades = [&w]() {
+            hft::TimePoint now = hft::ClockType::now();
+            for(long i = 0; i < TRADES; ++i)
+                w.addTrade(now, 3350.25 + (i % 8) * 0.25, 1 + i % 9, "CME", 3, i % w.size());
+            return static_cast<double>(TRADES);
+        };
+        auto flush = [&w]() { return static_cast<double>(w.flushToDB().tradeRows); };
+        // each run starts from an empty bundle
+        std::vector<Case> writerCases;
+        writerCases.push_back(Case{"tick_writer_add_trade", TRADES, addTrades, [flush]() { flush(); }});
+        writerCases.push_back(Case{"tick_writer_flush_1000_trades", 1, flush, [addTrades]() { addTrades(); }});
+        checksum += report(writerCases, repeats, baseline);
+    }
+
+    std::fprintf(stderr, "(checksum %g)\n", checksum);
+    return 0;
+}
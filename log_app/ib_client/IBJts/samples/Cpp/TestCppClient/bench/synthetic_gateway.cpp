@@ -0,0 +1,692 @@
+/*
+ * stands in for IB Gateway, to load test the logger without a login or
+ * market hours: does the v100+ handshake, answers startApi with
+ * nextValidId, then streams made up tick-by-tick, market depth and
+ * real time bar messages for whatever the client subscribes to
+ *
+ * usage: ./synthetic_gateway [-p port] [-r messages/s] [-b burst]
+ *                            [-s spike] [-i instruments] [-d seconds]
+ *                            [-l depth levels]
+ *
+ *   -p  port to listen on (4002, the paper gateway's)
+ *   -r  messages a second per connection, over all its subscriptions;
+ *       0 sends as fast as the client reads (100000)
+ *   -b  messages sent back to back in one write; bursts are spread
+ *       out to make the rate (100)
+ *   -s  the first tenth of every second runs at spike times the rate,
+ *       like the open (1)
+ *   -i  stream only the first n instruments subscribed to, 0 for all;
+ *       list more in tickers.txt for more (0)
+ *   -d  close the connection after this many seconds, 0 never (0)
+ *   -l  depth levels per side (10)
+ *
+ * Run the logger against it with IB_GATEWAY_URLNAME=127.0.0.1 and
+ * IB_GATEWAY_URLPORT set to the port. Every second each connection
+ * prints what it sent, and how many messages it is behind the rate
+ * because the client didn't read them fast enough: a backlog that keeps
+ * growing means the rate is more than the client can take.
+ */
+#include "StdAfx.h"
+#include "EDecoder.h"
+#include "EClient.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace ibapi::client_constants; // the request ids
+using GatewayClock = std::chrono::steady_clock;
+
+
+struct Options {
+    int port = 4002;
+    double rate = 100000;
+    int burst = 100;
+    double spike = 1;
+    unsigned instruments = 0;
+    double seconds = 0;
+    int levels = 10;
+};
+
+
+static const int SERVER_VERSION = MAX_CLIENT_VER;
+static const double TICK = 0.25;
+
+
+enum SubscriptionKind { SUB_LAST, SUB_ALL_LAST, SUB_BID_ASK, SUB_MID_POINT, SUB_DEPTH, SUB_BARS };
+
+
+struct Subscription {
+    int reqId;
+    SubscriptionKind kind;
+    unsigned instrument;
+    bool smartDepth;
+};
+
+
+/* one contract's made up market */
+struct Instrument {
+    std::string key;     // symbol and local symbol of the request
+    long mid;            // in ticks
+    int sizes[2][64];    // depth, indexed by side (0 ask, 1 bid) and level
+    int rows;            // depth levels sent so far
+    int pendingInsert[2]; // a level deleted last time, to put back; -1 for none
+    // the bar in the making
+    double open, high, low, close, volume, notional;
+    int count;
+};
+
+
+/* a small, fast generator; quality doesn't matter here */
+class Random {
+public:
+    explicit Random(std::uint64_t seed) : m_state(seed ? seed : 1) {}
+
+    std::uint64_t next() {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 7;
+        m_state ^= m_state << 17;
+        return m_state;
+    }
+
+    int below(int n) { return static_cast<int>(next() % n); }
+
+private:
+    std::uint64_t m_state;
+};
+
+
+/* builds length prefixed messages one field at a time */
+class Writer {
+public:
+    void begin() {
+        m_start = m_out.size();
+        m_out.append(4, '\0');
+    }
+
+    void end() {
+        std::uint32_t len = htonl(static_cast<std::uint32_t>(m_out.size() - m_start - 4));
+        std::memcpy(&m_out[m_start], &len, 4);
+    }
+
+    void field(const char* s) {
+        m_out += s;
+        m_out.push_back('\0');
+    }
+
+    void field(const std::string& s) { field(s.c_str()); }
+
+    void field(long long v) {
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), "%lld", v);
+        field(buf);
+    }
+
+    void field(int v) { field(static_cast<long long>(v)); }
+
+    void price(double v) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.2f", v);
+        field(buf);
+    }
+
+    std::string& out() { return m_out; }
+    void clear() { m_out.clear(); }
+
+private:
+    std::string m_out;
+    std::size_t m_start = 0;
+};
+
+
+static std::vector<std::string> splitFields(const char* msg, std::size_t size) {
+    std::vector<std::string> fields;
+    const char* p = msg;
+    const char* end = msg + size;
+    while(p < end) {
+        const char* nul = static_cast<const char*>(std::memchr(p, 0, end - p));
+        if( !nul )
+            break;
+        fields.push_back(std::string(p, nul));
+        p = nul + 1;
+    }
+    return fields;
+}
+
+
+static bool sendAll(int fd, const std::string& bytes) {
+    std::size_t sent = 0;
+    while(sent < bytes.size()) {
+        ssize_t n = ::send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if( n <= 0 )
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+
+class Connection {
+public:
+    Connection(int fd, int id, const Options& options)
+        : m_fd(fd), m_id(id), m_options(options), m_random(0x9e3779b97f4a7c15ULL * (id + 1))
+    {}
+
+    ~Connection() { ::close(m_fd); }
+
+    void run();
+
+private:
+    bool readRequests(bool block);
+    bool handle(const char* msg, std::size_t size);
+    unsigned instrument(const std::vector<std::string>& fields, std::size_t symbol, std::size_t localSymbol);
+    void subscribe(int reqId, SubscriptionKind kind, unsigned instrument, bool smartDepth);
+    void cancel(int reqId);
+    bool streaming(const Subscription& sub) const;
+
+    void tick(Subscription& sub);
+    void trade(const Subscription& sub, Instrument& inst, int tickType);
+    void quote(const Subscription& sub, Instrument& inst);
+    void midPoint(const Subscription& sub, Instrument& inst);
+    void depth(const Subscription& sub, Instrument& inst, int position, int operation, int side);
+    void depthUpdate(const Subscription& sub, Instrument& inst);
+    void bars(long long now);
+
+    int m_fd;
+    int m_id;
+    Options m_options;
+    Random m_random;
+    std::string m_in;
+    bool m_handshaken = false;
+    bool m_started = false;
+    std::vector<Subscription> m_subs;
+    std::vector<Instrument> m_instruments;
+    Writer m_writer;
+    long long m_lastBar = 0;
+    unsigned long long m_sent = 0;
+    unsigned long long m_bytes = 0;
+};
+
+
+bool Connection::readRequests(bool block) {
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int ret = ::poll(&pfd, 1, block ? 100 : 0);
+    if( ret < 0 )
+        return errno == EINTR;
+    if( ret == 0 )
+        return true;
+
+    char buf[65536];
+    ssize_t n = ::recv(m_fd, buf, sizeof(buf), 0);
+    if( n <= 0 )
+        return false;
+    m_in.append(buf, n);
+
+    for(;;) {
+        std::size_t pos = 0;
+        // the client opens with "API\0", then every message is length prefixed
+        if( !m_handshaken ) {
+            if( m_in.size() < 4 )
+                return true;
+            if( m_in.compare(0, 4, std::string("API\0", 4)) != 0 )
+                return false;
+            pos = 4;
+        }
+        if( m_in.size() < pos + 4 )
+            return true;
+        std::uint32_t len;
+        std::memcpy(&len, m_in.data() + pos, 4);
+        len = ntohl(len);
+        if( m_in.size() < pos + 4 + len )
+            return true;
+        if( !handle(m_in.data() + pos + 4, len) )
+            return false;
+        m_in.erase(0, pos + 4 + len);
+    }
+}
+
+
+bool Connection::handle(const char* msg, std::size_t size) {
+    // "v100..155 options": answer with the version and the gateway's time
+    if( !m_handshaken ) {
+        m_handshaken = true;
+        int minVersion = 0, maxVersion = 0;
+        if( std::sscanf(std::string(msg, size).c_str(), "v%d..%d", &minVersion, &maxVersion) < 1 )
+            return false;
+        if( maxVersion == 0 )
+            maxVersion = minVersion;
+        if( minVersion > SERVER_VERSION )
+            return false;
+        char now[32];
+        std::time_t t = std::time(0);
+        std::strftime(now, sizeof(now), "%Y%m%d %H:%M:%S UTC", std::gmtime(&t));
+        m_writer.begin();
+        m_writer.field(std::min(SERVER_VERSION, maxVersion));
+        m_writer.field(now);
+        m_writer.end();
+        return true;
+    }
+
+    std::vector<std::string> fields = splitFields(msg, size);
+    if( fields.empty() )
+        return true;
+
+    switch(std::atoi(fields[0].c_str())) {
+    case START_API:
+        m_started = true;
+        m_writer.begin();
+        m_writer.field(NEXT_VALID_ID);
+        m_writer.field(1);
+        m_writer.field(1);
+        m_writer.end();
+        m_writer.begin();
+        m_writer.field(MANAGED_ACCTS);
+        m_writer.field(1);
+        m_writer.field("DU0000000");
+        m_writer.end();
+        break;
+    case REQ_TICK_BY_TICK_DATA:
+        // msgId reqId conId symbol secType expiry strike right multiplier
+        // exchange primaryExchange currency localSymbol tradingClass tickType ...
+        if( fields.size() > 14 ) {
+            const std::string& type = fields[14];
+            SubscriptionKind kind = type == "Last" ? SUB_LAST : type == "AllLast" ? SUB_ALL_LAST
+                                  : type == "BidAsk" ? SUB_BID_ASK : SUB_MID_POINT;
+            subscribe(std::atoi(fields[1].c_str()), kind, instrument(fields, 3, 12), false);
+        }
+        break;
+    case REQ_MKT_DEPTH:
+        // msgId version reqId conId symbol secType expiry strike right multiplier
+        // exchange primaryExchange currency localSymbol tradingClass numRows isSmartDepth ...
+        if( fields.size() > 16 )
+            subscribe(std::atoi(fields[2].c_str()), SUB_DEPTH, instrument(fields, 4, 13), fields[16] == "1");
+        break;
+    case REQ_REAL_TIME_BARS:
+        // msgId version reqId conId symbol secType expiry strike right multiplier
+        // exchange primaryExchange currency localSymbol ...
+        if( fields.size() > 13 )
+            subscribe(std::atoi(fields[2].c_str()), SUB_BARS, instrument(fields, 4, 13), false);
+        break;
+    case CANCEL_TICK_BY_TICK_DATA:
+        if( fields.size() > 1 )
+            cancel(std::atoi(fields[1].c_str()));
+        break;
+    case CANCEL_MKT_DEPTH:
+    case CANCEL_REAL_TIME_BARS:
+        if( fields.size() > 2 )
+            cancel(std::atoi(fields[2].c_str()));
+        break;
+    default:
+        // everything else goes unanswered
+        break;
+    }
+    return true;
+}
+
+
+unsigned Connection::instrument(const std::vector<std::string>& fields, std::size_t symbol, std::size_t localSymbol) {
+    std::string key = fields[symbol] + " " + (localSymbol < fields.size() ? fields[localSymbol] : "");
+    for(unsigned i = 0; i < m_instruments.size(); ++i)
+        if( m_instruments[i].key == key )
+            return i;
+
+    Instrument inst;
+    inst.key = key;
+    inst.mid = 16000 + 400 * static_cast<long>(m_instruments.size()); // 4000.00, 4100.00, ...
+    inst.rows = 0;
+    inst.pendingInsert[0] = inst.pendingInsert[1] = -1;
+    inst.count = 0;
+    inst.volume = inst.notional = 0;
+    m_instruments.push_back(inst);
+    return m_instruments.size() - 1;
+}
+
+
+void Connection::subscribe(int reqId, SubscriptionKind kind, unsigned instrument, bool smartDepth) {
+    Subscription sub;
+    sub.reqId = reqId;
+    sub.kind = kind;
+    sub.instrument = instrument;
+    sub.smartDepth = smartDepth;
+    m_subs.push_back(sub);
+
+    // a new book starts with all its levels
+    if( kind == SUB_DEPTH && streaming(sub) ) {
+        Instrument& inst = m_instruments[instrument];
+        const int levels = std::min(m_options.levels, 64);
+        for(int side = 0; side < 2; ++side)
+            for(int pos = 0; pos < levels; ++pos) {
+                inst.sizes[side][pos] = 1 + m_random.below(50);
+                depth(sub, inst, pos, 0, side);
+            }
+        inst.rows = levels;
+    }
+}
+
+
+void Connection::cancel(int reqId) {
+    m_subs.erase(std::remove_if(m_subs.begin(), m_subs.end(),
+                                [reqId](const Subscription& s) { return s.reqId == reqId; }),
+                 m_subs.end());
+}
+
+
+bool Connection::streaming(const Subscription& sub) const {
+    return m_options.instruments == 0 || sub.instrument < m_options.instruments;
+}
+
+
+void Connection::trade(const Subscription& sub, Instrument& inst, int tickType) {
+    // the mid price wanders a tick at a time
+    int move = m_random.below(16);
+    if( move == 0 )
+        inst.mid--;
+    else if( move == 1 )
+        inst.mid++;
+
+    const double price = (inst.mid + m_random.below(2)) * TICK;
+    const int size = 1 + m_random.below(10);
+
+    m_writer.begin();
+    m_writer.field(TICK_BY_TICK);
+    m_writer.field(sub.reqId);
+    m_writer.field(tickType);
+    m_writer.field(static_cast<long long>(std::time(0)));
+    m_writer.price(price);
+    m_writer.field(size);
+    m_writer.field(0);
+    m_writer.field("CME");
+    m_writer.field("");
+    m_writer.end();
+
+    if( inst.count == 0 ) {
+        inst.open = inst.high = inst.low = price;
+    } else {
+        inst.high = std::max(inst.high, price);
+        inst.low = std::min(inst.low, price);
+    }
+    inst.close = price;
+    inst.volume += size;
+    inst.notional += price * size;
+    inst.count++;
+}
+
+
+void Connection::quote(const Subscription& sub, Instrument& inst) {
+    m_writer.begin();
+    m_writer.field(TICK_BY_TICK);
+    m_writer.field(sub.reqId);
+    m_writer.field(3);
+    m_writer.field(static_cast<long long>(std::time(0)));
+    m_writer.price(inst.mid * TICK);
+    m_writer.price((inst.mid + 1) * TICK);
+    m_writer.field(1 + m_random.below(200));
+    m_writer.field(1 + m_random.below(200));
+    m_writer.field(0);
+    m_writer.end();
+}
+
+
+void Connection::midPoint(const Subscription& sub, Instrument& inst) {
+    m_writer.begin();
+    m_writer.field(TICK_BY_TICK);
+    m_writer.field(sub.reqId);
+    m_writer.field(4);
+    m_writer.field(static_cast<long long>(std::time(0)));
+    m_writer.price((inst.mid + 0.5) * TICK);
+    m_writer.end();
+}
+
+
+/* one level of one side: asks above the mid, bids from it down */
+void Connection::depth(const Subscription& sub, Instrument& inst, int position, int operation, int side) {
+    const double price = side == 0 ? (inst.mid + 1 + position) * TICK : (inst.mid - position) * TICK;
+
+    m_writer.begin();
+    if( sub.smartDepth ) {
+        m_writer.field(MARKET_DEPTH_L2);
+        m_writer.field(1);
+        m_writer.field(sub.reqId);
+        m_writer.field(position);
+        m_writer.field("CME");
+        m_writer.field(operation);
+        m_writer.field(side);
+        m_writer.price(price);
+        m_writer.field(inst.sizes[side][position]);
+        m_writer.field(1);
+    } else {
+        m_writer.field(MARKET_DEPTH);
+        m_writer.field(1);
+        m_writer.field(sub.reqId);
+        m_writer.field(position);
+        m_writer.field(operation);
+        m_writer.field(side);
+        m_writer.price(price);
+        m_writer.field(inst.sizes[side][position]);
+    }
+    m_writer.end();
+}
+
+
+/* mostly size changes; now and then a level goes and comes back, so the book stays full */
+void Connection::depthUpdate(const Subscription& sub, Instrument& inst) {
+    const int side = m_random.below(2);
+
+    if( inst.pendingInsert[side] >= 0 ) {
+        const int pos = inst.pendingInsert[side];
+        inst.pendingInsert[side] = -1;
+        inst.sizes[side][pos] = 1 + m_random.below(50);
+        depth(sub, inst, pos, 0, side);
+        return;
+    }
+
+    const int pos = m_random.below(inst.rows);
+    if( m_random.below(10) == 0 ) {
+        depth(sub, inst, pos, 2, side);
+        inst.pendingInsert[side] = pos;
+        return;
+    }
+
+    inst.sizes[side][pos] = 1 + m_random.below(50);
+    depth(sub, inst, pos, 1, side);
+}
+
+
+void Connection::tick(Subscription& sub) {
+    Instrument& inst = m_instruments[sub.instrument];
+    switch(sub.kind) {
+    case SUB_LAST:      trade(sub, inst, 1); break;
+    case SUB_ALL_LAST:  trade(sub, inst, 2); break;
+    case SUB_BID_ASK:   quote(sub, inst); break;
+    case SUB_MID_POINT: midPoint(sub, inst); break;
+    case SUB_DEPTH:     if( inst.rows > 0 ) depthUpdate(sub, inst); break;
+    case SUB_BARS:      break;
+    }
+}
+
+
+/* real time bars come every five seconds, made of the trades sent since */
+void Connection::bars(long long now) {
+    if( now - m_lastBar < 5 )
+        return;
+    m_lastBar = now - now % 5;
+
+    for(const Subscription& sub : m_subs) {
+        if( sub.kind != SUB_BARS || !streaming(sub) )
+            continue;
+        Instrument& inst = m_instruments[sub.instrument];
+        const double last = inst.count ? inst.close : inst.mid * TICK;
+        m_writer.begin();
+        m_writer.field(REAL_TIME_BARS);
+        m_writer.field(3);
+        m_writer.field(sub.reqId);
+        m_writer.field(m_lastBar - 5);
+        m_writer.price(inst.count ? inst.open : last);
+        m_writer.price(inst.count ? inst.high : last);
+        m_writer.price(inst.count ? inst.low : last);
+        m_writer.price(last);
+        m_writer.field(static_cast<long long>(inst.volume));
+        m_writer.price(inst.volume > 0 ? inst.notional / inst.volume : last);
+        m_writer.field(inst.count);
+        m_writer.end();
+    }
+    for(Instrument& inst : m_instruments) {
+        inst.count = 0;
+        inst.volume = inst.notional = 0;
+    }
+}
+
+
+void Connection::run() {
+    const GatewayClock::time_point start = GatewayClock::now();
+    GatewayClock::time_point last = start;
+    GatewayClock::time_point report = start + std::chrono::seconds(1);
+    double owed = 0; // messages the rate called for that haven't gone out yet
+    unsigned long long reportSent = 0, reportBytes = 0;
+    std::vector<unsigned> live; // indexes of the subscriptions streamed
+
+    for(;;) {
+        // requests, and the answers to them, come first
+        if( !readRequests(m_subs.empty()) )
+            break;
+        if( !m_writer.out().empty() ) {
+            if( !sendAll(m_fd, m_writer.out()) )
+                break;
+            m_writer.clear();
+        }
+
+        const GatewayClock::time_point now = GatewayClock::now();
+        const double elapsed = std::chrono::duration<double>(now - start).count();
+        if( m_options.seconds > 0 && elapsed >= m_options.seconds )
+            break;
+
+        if( now >= report ) {
+            std::printf("connection %d: %llu messages/s, %.1f MB/s, %.0f behind, %zu subscriptions\n",
+                        m_id, m_sent - reportSent, (m_bytes - reportBytes) / 1e6, owed, m_subs.size());
+            std::fflush(stdout);
+            reportSent = m_sent;
+            reportBytes = m_bytes;
+            report += std::chrono::seconds(1);
+        }
+
+        live.clear();
+        for(unsigned i = 0; i < m_subs.size(); ++i)
+            if( m_subs[i].kind != SUB_BARS && streaming(m_subs[i]) )
+                live.push_back(i);
+        if( !m_started || live.empty() ) {
+            last = now;
+            continue;
+        }
+
+        // the rate this part of the second runs at
+        const double fraction = elapsed - static_cast<long>(elapsed);
+        const double rate = m_options.rate * (fraction < 0.1 ? m_options.spike : 1);
+
+        int burst = m_options.burst;
+        if( rate > 0 ) {
+            owed += rate * std::chrono::duration<double>(now - last).count();
+            last = now;
+            if( owed < burst ) {
+                // sleep until the next burst is due, or a request comes in
+                const double wait = (burst - owed) / rate;
+                struct timespec ts;
+                ts.tv_sec = static_cast<time_t>(wait);
+                ts.tv_nsec = static_cast<long>((wait - ts.tv_sec) * 1e9);
+                struct pollfd pfd;
+                pfd.fd = m_fd;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+                ::ppoll(&pfd, 1, &ts, 0);
+                continue;
+            }
+            owed -= burst;
+        }
+
+        for(int i = 0; i < burst; ++i)
+            tick(m_subs[live[m_random.below(live.size())]]);
+        bars(std::time(0));
+
+        m_sent += burst;
+        m_bytes += m_writer.out().size();
+        if( !sendAll(m_fd, m_writer.out()) )
+            break;
+        m_writer.clear();
+    }
+
+    std::printf("connection %d closed after %llu messages\n", m_id, m_sent);
+    std::fflush(stdout);
+}
+
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    int opt;
+    while((opt = ::getopt(argc, argv, "p:r:b:s:i:d:l:")) != -1) {
+        switch(opt) {
+        case 'p': options.port = std::atoi(optarg); break;
+        case 'r': options.rate = std::atof(optarg); break;
+        case 'b': options.burst = std::max(1, std::atoi(optarg)); break;
+        case 's': options.spike = std::atof(optarg); break;
+        case 'i': options.instruments = std::atoi(optarg); break;
+        case 'd': options.seconds = std::atof(optarg); break;
+        case 'l': options.levels = std::max(1, std::min(64, std::atoi(optarg))); break;
+        default: return false;
+        }
+    }
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if( !parseOptions(argc, argv, options) ) {
+        std::fprintf(stderr, "usage: %s [-p port] [-r messages/s] [-b burst] [-s spike] [-i instruments] [-d seconds] [-l depth levels]\n", argv[0]);
+        return 1;
+    }
+
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(options.port);
+    if( ::bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listener, 8) < 0 ) {
+        std::perror("listen");
+        return 1;
+    }
+    std::printf("listening on 127.0.0.1:%d, %.0f messages/s in bursts of %d\n", options.port, options.rate, options.burst);
+    std::fflush(stdout);
+
+    for(int id = 0; ; ++id) {
+        int fd = ::accept(listener, 0, 0);
+        if( fd < 0 )
+            continue;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        std::thread([fd, id, options]() {
+            Connection connection(fd, id, options);
+            connection.run();
+        }).detach();
+    }
+}
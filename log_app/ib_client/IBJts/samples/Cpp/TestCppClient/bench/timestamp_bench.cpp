@@ -0,0 +1,70 @@
+/*
+ * compares formatTimestamp() with the strftime/localtime formatting
+ * it replaced
+ *
+ * usage: ./timestamp_bench [calls] [nanoseconds between ticks]
+ */
+#include "timestamp.h"
+
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+
+using namespace hft;
+using BenchClock = std::chrono::steady_clock;
+
+
+/* what tick_writer.cpp used to do for every row */
+static std::string legacyToString(std::int64_t nanos) {
+    std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds(nanos));
+    std::chrono::seconds s = std::chrono::duration_cast<std::chrono::seconds>(ms);
+    std::time_t t = s.count();
+    std::size_t fractional_seconds = ms.count() %1000;
+    char cstr[100];
+    std::strftime(cstr, sizeof(cstr), "%Y-%m-%d %H:%M:%OS", std::localtime(&t));
+    return std::string(cstr) + std::string(".") + std::to_string(fractional_seconds);
+}
+
+
+int main(int argc, char** argv)
+{
+    const long calls = argc > 1 ? std::atol(argv[1]) : 5000000;
+    const long step = argc > 2 ? std::atol(argv[2]) : 50000; // 20k ticks a second
+    const std::int64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // keep the compiler from throwing the work away
+    unsigned long checksum = 0;
+
+    BenchClock::time_point t0 = BenchClock::now();
+    for(long i = 0; i < calls; ++i)
+        checksum += legacyToString(start + i * step).back();
+    BenchClock::time_point t1 = BenchClock::now();
+
+    char out[TIMESTAMP_LEN];
+    for(long i = 0; i < calls; ++i)
+        checksum += out[formatTimestamp(out, start + i * step) - 1];
+    BenchClock::time_point t2 = BenchClock::now();
+
+    std::string appended;
+    appended.reserve(TIMESTAMP_LEN);
+    for(long i = 0; i < calls; ++i) {
+        appended.clear();
+        appended.append(out, formatTimestamp(out, start + i * step));
+        checksum += appended.back();
+    }
+    BenchClock::time_point t3 = BenchClock::now();
+
+    auto per_call = [calls](BenchClock::time_point a, BenchClock::time_point b) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count() / static_cast<double>(calls);
+    };
+    std::printf("%ld calls, %ld ns apart\n", calls, step);
+    std::printf("strftime + localtime     %8.1f ns/call\n", per_call(t0, t1));
+    std::printf("formatTimestamp          %8.1f ns/call\n", per_call(t1, t2));
+    std::printf("formatTimestamp + string %8.1f ns/call\n", per_call(t2, t3));
+    std::printf("(checksum %lu)\n", checksum);
+    return 0;
+}
@@ -42,13 +42,15 @@ FutTradingContract::FutTradingContract(const std::string& sym,
                                        float commiss_per_contract, 
                                        unsigned multiplier, 
                                        unsigned chillness, 
-                                       unsigned num_contracts)
+                                       unsigned num_contracts,
+                                       StreamMask streams)
     : BasicContract(sym, loc_sym, sec_type, currency, exch), 
     m_mt(min_tick), 
     m_cpc(commiss_per_contract), 
     m_mlt(multiplier), 
     m_c(chillness), 
-    m_nc(num_contracts)
+    m_nc(num_contracts),
+    m_streams(streams)
 {
 }
 
@@ -166,13 +168,13 @@ void FutCalendarSpreadConfig::makeUpperAndTrim(std::string& s)
 
 
 FutSymsConfig::FutSymsConfig(const std::string& file)
+    : m_first_uid(4000)
 {
 
     std::ifstream fs(file);
-    unsigned int dyn_sym_unique_id (4000);
     if( fs.good() ){
 
-        std::string _root, _st, _exch, _ls, _mt, _cpc, _mult, _chill, _nc, _curr, line;
+        std::string _root, _st, _exch, _ls, _mt, _cpc, _mult, _chill, _nc, _curr, _streams, line;
         while( std::getline(fs, line) ){
 
             if( !line.empty() ){
@@ -189,6 +191,17 @@ FutSymsConfig::FutSymsConfig(const std::string& file)
                 std::getline(stream, _chill, ',');
                 std::getline(stream, _nc, ',');
                 std::getline(stream, _curr, ',');
+                if( !std::getline(stream, _streams, ',') )
+                    _streams.clear();
+
+                // trades only, unless it says otherwise
+                StreamMask streams = 0;
+                std::istringstream names(_streams);
+                std::string name;
+                while( names >> name )
+                    streams |= streamBit(parse_stream(name));
+                if( streams == 0 )
+                    streams = streamBit(STREAM_LAST);
 
                 // store the info
                 m_contracts.push_back(FutTradingContract(_root, _ls, _st, _curr, _exch, 
@@ -196,17 +209,9 @@ FutSymsConfig::FutSymsConfig(const std::string& file)
                                                          std::stof(_cpc), 
                                                          std::stoi(_mult), 
                                                          std::stoi(_chill), 
-                                                         std::stoi(_nc)));
-            
-                // set order and trade ids
-                m_unique_order_ids.insert(
-                        std::pair<std::string,unsigned int>(
-                            BasicContract::uppercase(_ls), 
-                                dyn_sym_unique_id++));
-                m_unique_trade_ids.insert(
-                        std::pair<std::string,unsigned int>(
-                            BasicContract::uppercase(_ls), 
-                                dyn_sym_unique_id++));
+                                                         std::stoi(_nc),
+                                                         streams));
+                m_instruments[BasicContract::uppercase(_ls)] = m_contracts.size() - 1;
             }
         }
 
@@ -216,6 +221,31 @@ FutSymsConfig::FutSymsConfig(const std::string& file)
 }
 
 
+StreamType FutSymsConfig::parse_stream(const std::string& name)
+{
+    const std::string upper = BasicContract::uppercase(name);
+    for(unsigned s = 0; s < NUM_STREAMS; ++s) {
+        if(upper == BasicContract::uppercase(stream_name(static_cast<StreamType>(s))))
+            return static_cast<StreamType>(s);
+    }
+    throw std::runtime_error("unknown stream " + name + "\n");
+}
+
+
+const char* FutSymsConfig::stream_name(StreamType stream)
+{
+    switch(stream) {
+    case STREAM_LAST:      return "Last";
+    case STREAM_ALL_LAST:  return "AllLast";
+    case STREAM_BID_ASK:   return "BidAsk";
+    case STREAM_MID_POINT: return "MidPoint";
+    case STREAM_DEPTH:     return "Depth";
+    case STREAM_BARS:      return "Bars";
+    default:               return "";
+    }
+}
+
+
 std::map<char,int> FutSymsConfig::create_map()
 {
     std::map<char,int> m;
@@ -9,6 +9,35 @@
 namespace hft {
 
 
+/* position of an instrument in the symbol file */
+using InstrumentId = unsigned int;
+
+/* what instrument_from_uid() returns for a request id it didn't hand out */
+const InstrumentId NO_INSTRUMENT = ~0u;
+
+
+/**
+ * @enum StreamType
+ * @brief the market data an instrument can be subscribed to
+ * (each gets a request id of its own, see FutSymsConfig::request_id())
+ */
+enum StreamType : unsigned char {
+    STREAM_LAST,      // tick-by-tick "Last" trades
+    STREAM_ALL_LAST,  // tick-by-tick "AllLast" trades (Last plus unreported ones)
+    STREAM_BID_ASK,   // tick-by-tick top of book
+    STREAM_MID_POINT, // tick-by-tick mid point
+    STREAM_DEPTH,     // level 2 market depth
+    STREAM_BARS,      // 5 second real time bars
+    NUM_STREAMS
+};
+
+
+/* a set of StreamTypes, one bit each */
+using StreamMask = unsigned int;
+
+inline StreamMask streamBit(StreamType stream) { return 1u << stream; }
+
+
 /**
  * @brief stores information for a contract
  * automatically converts strings to uppercase
@@ -51,7 +80,8 @@ public:
                        float commiss_per_contract, 
                        unsigned multiplier, 
                        unsigned chillness, 
-                       unsigned num_contracts);
+                       unsigned num_contracts,
+                       StreamMask streams = streamBit(STREAM_LAST));
 
     /* getters */
     float min_tick() const { return m_mt; }
@@ -59,8 +89,10 @@ public:
     float multiplier() const { return m_mlt; }
     float chillness() const { return m_c; }
     float num_contracts() const { return m_nc; }
+    StreamMask streams() const { return m_streams; }
 private:
     float m_mt, m_cpc, m_mlt, m_c, m_nc;
+    StreamMask m_streams;
 };
 
 
@@ -131,9 +163,14 @@ private:
  *  8. chillness
  *  9. num_contracts
  *  10. currency 
+ *  11. streams to subscribe to, separated by spaces (optional, 
+ *      Last if left out): Last, AllLast, BidAsk, MidPoint, Depth, Bars
  *
  * Example:
- * MES,FUT,GLOBEX,MESH0,.25,.47,5,0,1,USD
+ * MES,FUT,GLOBEX,MESH0,.25,.47,5,0,1,USD,Last BidAsk Depth
+ *
+ * Every instrument gets NUM_STREAMS consecutive request ids, one
+ * per StreamType, whether it subscribes to them all or not.
  *
  */
 class FutSymsConfig {
@@ -153,26 +190,48 @@ public:
     unsigned int chillness        (unsigned int idx)            const { return m_contracts[idx].chillness(); }
     unsigned int num_contracts    (unsigned int idx)            const { return m_contracts[idx].num_contracts(); }
     std::string  currencies       (unsigned int idx)            const { return m_contracts[idx].currency(); }
-    unsigned int unique_order_id  (const std::string& ticker)   const { return m_unique_order_ids.at(ticker); }
-    unsigned int unique_trade_id  (const std::string& ticker)   const { return m_unique_trade_ids.at(ticker); }
+    StreamMask   streams          (unsigned int idx)            const { return m_contracts[idx].streams(); }
+    unsigned int unique_order_id  (const std::string& ticker)   const { return request_id(m_instruments.at(ticker), STREAM_BID_ASK); }
+    unsigned int unique_trade_id  (const std::string& ticker)   const { return request_id(m_instruments.at(ticker), STREAM_LAST); }
+
+    /* the request id for one stream of an instrument */
+    unsigned int request_id(InstrumentId inst, StreamType stream) const { 
+        return m_first_uid + inst * NUM_STREAMS + stream; 
+    }
     std::string  loc_sym_from_uid (unsigned int uid)            const { 
-        for(auto iter = m_unique_order_ids.begin(); iter != m_unique_order_ids.end(); ++iter){
-            if( iter->second == uid)
-                return iter->first;
-        }
-        for(auto iter = m_unique_trade_ids.begin(); iter != m_unique_trade_ids.end(); ++iter){
-            if( iter->second == uid)
-                return iter->first;
-        }
-        throw std::runtime_error("local symbol not found");
+        InstrumentId inst = instrument_from_uid(uid);
+        if( inst == NO_INSTRUMENT )
+            throw std::runtime_error("local symbol not found");
+        return loc_syms(inst);
     }
 
+    /* constant time, for use on every tick */
+    InstrumentId instrument_from_uid(unsigned int uid)            const {
+        unsigned int offset = uid - m_first_uid; // wraps around for uid < m_first_uid
+        return offset < m_contracts.size() * NUM_STREAMS ? offset / NUM_STREAMS : NO_INSTRUMENT;
+    }
+
+    /* which stream a request id belongs to (only meaningful if instrument_from_uid() found it) */
+    StreamType stream_from_uid(unsigned int uid) const {
+        return static_cast<StreamType>((uid - m_first_uid) % NUM_STREAMS);
+    }
+
+    /* parses a stream name (case insensitive), throws if there's no such stream */
+    static StreamType parse_stream(const std::string& name);
+
+    /* what IB calls a tick-by-tick stream ("Last", "BidAsk", ...) */
+    static const char* stream_name(StreamType stream);
+
     static std::map<char,int> create_map();
     static std::map<char,int> contract_months;
 private:
     std::vector<FutTradingContract> m_contracts;
-    std::map<std::string, unsigned int> m_unique_trade_ids;
-    std::map<std::string, unsigned int> m_unique_order_ids;
+
+    /* instrument of each local symbol */
+    std::map<std::string, InstrumentId> m_instruments;
+
+    /* request ids start here, NUM_STREAMS of them per instrument */
+    unsigned int m_first_uid;
 
 
     // checker and helper
@@ -0,0 +1,158 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef> // size_t
+
+
+namespace hft {
+
+
+/**
+ * @class LatencyHistogram
+ * @brief log-linear histogram of durations in nanoseconds
+ *
+ * Each power of two is split into SUB_BUCKETS equal buckets,
+ * so any recorded value is reported to within 1/SUB_BUCKETS
+ * of itself. Recording is a couple of relaxed atomic
+ * increments, so one thread can record while others read.
+ */
+class LatencyHistogram {
+public:
+
+    static const unsigned SUB_BITS = 3;
+    static const unsigned SUB_BUCKETS = 1u << SUB_BITS;
+    static const unsigned NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram() { reset(); }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+
+    /**
+     * @brief adds one observation
+     */
+    void record(std::uint64_t nanos) {
+        m_counts[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(nanos, std::memory_order_relaxed);
+        std::uint64_t prev = m_max.load(std::memory_order_relaxed);
+        while(nanos > prev && !m_max.compare_exchange_weak(prev, nanos, std::memory_order_relaxed))
+            ;
+    }
+
+
+    /**
+     * @brief record() for a histogram only one thread ever records
+     * into: plain loads and stores instead of read-modify-writes,
+     * so it costs about as much as a non-atomic histogram
+     */
+    void recordOwned(std::uint64_t nanos) {
+        std::atomic<std::uint64_t>& bucket = m_counts[bucketOf(nanos)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_sum.store(m_sum.load(std::memory_order_relaxed) + nanos, std::memory_order_relaxed);
+        if(nanos > m_max.load(std::memory_order_relaxed))
+            m_max.store(nanos, std::memory_order_relaxed);
+    }
+
+
+    /**
+     * @brief adds other's observations to these (this one must not
+     * be recorded into meanwhile; other may be)
+     */
+    void add(const LatencyHistogram& other) {
+        for(unsigned b = 0; b < NUM_BUCKETS; ++b)
+            m_counts[b].store(m_counts[b].load(std::memory_order_relaxed)
+                              + other.m_counts[b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_count.store(count() + other.count(), std::memory_order_relaxed);
+        m_sum.store(sum() + other.sum(), std::memory_order_relaxed);
+        if(other.max() > max())
+            m_max.store(other.max(), std::memory_order_relaxed);
+    }
+
+
+    /**
+     * @brief the value below which a fraction q (0 to 1) of
+     * the observations fall (upper edge of the bucket)
+     */
+    std::uint64_t percentile(double q) const {
+        const std::uint64_t total = count();
+        if(total == 0)
+            return 0;
+        std::uint64_t rank = static_cast<std::uint64_t>(q * total);
+        if(rank >= total)
+            rank = total - 1;
+        std::uint64_t seen = 0;
+        for(unsigned b = 0; b < NUM_BUCKETS; ++b) {
+            seen += m_counts[b].load(std::memory_order_relaxed);
+            if(seen > rank)
+                return upperEdge(b) < max() ? upperEdge(b) : max();
+        }
+        return max();
+    }
+
+
+    /**
+     * @brief how many observations were at most nanos (to within a
+     * bucket: the ones in the bucket nanos falls in are counted too)
+     */
+    std::uint64_t countAtMost(std::uint64_t nanos) const {
+        const unsigned last = bucketOf(nanos);
+        std::uint64_t n = 0;
+        for(unsigned b = 0; b <= last; ++b)
+            n += m_counts[b].load(std::memory_order_relaxed);
+        return n;
+    }
+
+
+    std::uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+
+    std::uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+
+    std::uint64_t sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+    double mean() const { return count() ? static_cast<double>(sum()) / count() : 0.0; }
+
+
+    /**
+     * @brief zeroes everything (not safe against concurrent record())
+     */
+    void reset() {
+        for(unsigned b = 0; b < NUM_BUCKETS; ++b)
+            m_counts[b].store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+private:
+
+    static unsigned bucketOf(std::uint64_t v) {
+        if(v < SUB_BUCKETS)
+            return static_cast<unsigned>(v);
+        const unsigned msb = 63 - __builtin_clzll(v);
+        const unsigned shift = msb - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + static_cast<unsigned>((v >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static std::uint64_t upperEdge(unsigned b) {
+        if(b < SUB_BUCKETS)
+            return b;
+        const unsigned shift = b / SUB_BUCKETS - 1;
+        const std::uint64_t sub = b % SUB_BUCKETS;
+        return (((SUB_BUCKETS + sub + 1) << shift) - 1);
+    }
+
+    std::atomic<std::uint64_t> m_counts[NUM_BUCKETS];
+    std::atomic<std::uint64_t> m_count;
+    std::atomic<std::uint64_t> m_sum;
+    std::atomic<std::uint64_t> m_max;
+};
+
+
+} // namespace hft
+
+#endif // LATENCY_HISTOGRAM_H
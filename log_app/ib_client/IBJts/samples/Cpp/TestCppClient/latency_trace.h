@@ -0,0 +1,111 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "latency_histogram.h"
+
+
+namespace hft {
+
+
+/**
+ * @enum LatencyStage
+ * @brief the legs a tick's latency is split into, each measured
+ * from the end of the one before
+ */
+enum LatencyStage {
+    STAGE_FRAME,    // read off the socket -> queued for the decoding thread
+    STAGE_QUEUE,    // queued -> the decoding thread picks it up
+    STAGE_DECODE,   // decoding starts -> the callback
+    STAGE_ENQUEUE,  // the callback -> the row is handed to the TickWriter
+    STAGE_COMMIT,   // the callback (the row's dt) -> its flush is committed
+    NUM_LATENCY_STAGES
+};
+
+
+/**
+ * @class LatencyTrace
+ * @brief one histogram per stage per instrument
+ *
+ * Each histogram has a single writer (the commit stage's is the
+ * thread that flushes, the rest are the decoding thread's), so
+ * recording is recordOwned(), a handful of plain loads and stores.
+ * The histograms are cumulative; print() can run on any thread
+ * while they fill.
+ */
+class LatencyTrace {
+public:
+
+    explicit LatencyTrace(const std::vector<std::string>& instruments)
+        : m_names(instruments)
+        , m_histograms(new LatencyHistogram[instruments.size() * NUM_LATENCY_STAGES])
+    {
+    }
+
+
+    /**
+     * @brief adds one observation (from > to, as when the clock was
+     * stepped back, and unknown instruments are ignored)
+     */
+    void record(LatencyStage stage, unsigned instrument, std::int64_t from, std::int64_t to) {
+        if(instrument < m_names.size() && to >= from)
+            m_histograms[instrument * NUM_LATENCY_STAGES + stage].recordOwned(to - from);
+    }
+
+
+    const LatencyHistogram& histogram(LatencyStage stage, unsigned instrument) const {
+        return m_histograms[instrument * NUM_LATENCY_STAGES + stage];
+    }
+
+
+    unsigned instruments() const { return m_names.size(); }
+
+
+    /**
+     * @brief count, p50, p99, p99.9 and max of every stage, in
+     * microseconds, over all instruments and then per instrument
+     */
+    void print(std::FILE* out) const {
+        std::fprintf(out, "latency (us)               count        p50        p99      p99.9        max\n");
+        for(unsigned s = 0; s < NUM_LATENCY_STAGES; ++s) {
+            LatencyHistogram all;
+            for(unsigned i = 0; i < m_names.size(); ++i)
+                all.add(histogram(static_cast<LatencyStage>(s), i));
+            printLine(out, "all", s, all);
+        }
+        for(unsigned i = 0; i < m_names.size(); ++i) {
+            for(unsigned s = 0; s < NUM_LATENCY_STAGES; ++s) {
+                const LatencyHistogram& h = histogram(static_cast<LatencyStage>(s), i);
+                if(h.count() > 0)
+                    printLine(out, m_names[i].c_str(), s, h);
+            }
+        }
+    }
+
+
+    static const char* stageName(unsigned stage) {
+        static const char* const names[NUM_LATENCY_STAGES] = {"frame", "queue", "decode", "enqueue", "commit"};
+        return stage < NUM_LATENCY_STAGES ? names[stage] : "?";
+    }
+
+private:
+
+    static void printLine(std::FILE* out, const char* instrument, unsigned stage, const LatencyHistogram& h) {
+        std::fprintf(out, "%-10s %-8s %12llu %10.1f %10.1f %10.1f %10.1f\n",
+                     instrument, stageName(stage), static_cast<unsigned long long>(h.count()),
+                     h.percentile(0.5) / 1e3, h.percentile(0.99) / 1e3, h.percentile(0.999) / 1e3, h.max() / 1e3);
+    }
+
+    std::vector<std::string> m_names;
+    std::unique_ptr<LatencyHistogram[]> m_histograms;
+};
+
+
+} // namespace hft
+
+#endif // LATENCY_TRACE_H
@@ -0,0 +1,263 @@
+#include "metrics.h"
+
+#include <algorithm> // remove_if
+#include <cerrno>
+#include <cmath> // floor, fabs
+#include <cstdio> // snprintf
+#include <cstring> // strerror
+#include <stdexcept>
+#include <unistd.h> // close
+#include <poll.h>
+#include <sys/time.h> // timeval
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h> // inet_pton
+
+
+namespace hft{
+
+
+static const char* typeName(MetricsRegistry::Type type) {
+    switch(type) {
+        case MetricsRegistry::COUNTER:   return "counter";
+        case MetricsRegistry::GAUGE:     return "gauge";
+        case MetricsRegistry::HISTOGRAM: return "histogram";
+    }
+    return "untyped";
+}
+
+
+/* name{labels} value, or name value without labels */
+static void renderSample(std::string& out, const std::string& name, const std::string& labels, double value) {
+    char num[32];
+    if(value == std::floor(value) && std::fabs(value) < 1e15)
+        std::snprintf(num, sizeof(num), "%.0f", value);
+    else
+        std::snprintf(num, sizeof(num), "%.9g", value);
+    out += name;
+    if(!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += num;
+    out += '\n';
+}
+
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, const std::string& help, Type type)
+{
+    for(const std::unique_ptr<Family>& f : m_families) {
+        if(f->name == name)
+            return *f;
+    }
+    m_families.emplace_back(new Family {name, help, type, {}});
+    return *m_families.back();
+}
+
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    Family& f = family(name, help, COUNTER);
+    for(const Series& s : f.series) {
+        if(s.counter && s.labels == labels)
+            return *s.counter;
+    }
+    m_counters.emplace_back(new Counter);
+    Series s {labels, nullptr, m_counters.back().get(), nullptr, nullptr, {}, 1.0, nullptr};
+    f.series.push_back(s);
+    return *m_counters.back();
+}
+
+
+void MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels,
+                              std::function<double()> value, const void* owner)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    family(name, help, COUNTER).series.push_back(Series {labels, owner, nullptr, value, nullptr, {}, 1.0, nullptr});
+}
+
+
+void MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels,
+                            std::function<double()> value, const void* owner)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    family(name, help, GAUGE).series.push_back(Series {labels, owner, nullptr, value, nullptr, {}, 1.0, nullptr});
+}
+
+
+void MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::string& labels,
+                                const LatencyHistogram& histogram, std::vector<double> bounds, double scale,
+                                const void* owner)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    family(name, help, HISTOGRAM).series.push_back(Series {labels, owner, nullptr, nullptr, &histogram, bounds, scale, nullptr});
+}
+
+
+void MetricsRegistry::collect(const std::string& name, const std::string& help, Type type,
+                              std::function<void(std::vector<Sample>&)> collect, const void* owner)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    family(name, help, type).series.push_back(Series {"", owner, nullptr, nullptr, nullptr, {}, 1.0, collect});
+}
+
+
+void MetricsRegistry::remove(const void* owner)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    for(const std::unique_ptr<Family>& f : m_families) {
+        f->series.erase(std::remove_if(f->series.begin(), f->series.end(),
+                                       [owner](const Series& s) { return !s.counter && s.owner == owner; }),
+                        f->series.end());
+    }
+}
+
+
+void MetricsRegistry::renderHistogram(std::string& out, const std::string& name, const Series& s)
+{
+    // read the total first, so no bucket ends up above it
+    const std::uint64_t count = s.histogram->count();
+    const std::string sep = s.labels.empty() ? "" : s.labels + ",";
+    char le[32];
+    for(double bound : s.bounds) {
+        const std::uint64_t n = s.histogram->countAtMost(static_cast<std::uint64_t>(bound / s.scale));
+        std::snprintf(le, sizeof(le), "%g", bound);
+        renderSample(out, name + "_bucket", sep + "le=\"" + le + "\"", static_cast<double>(std::min(n, count)));
+    }
+    renderSample(out, name + "_bucket", sep + "le=\"+Inf\"", static_cast<double>(count));
+    renderSample(out, name + "_sum", s.labels, s.histogram->sum() * s.scale);
+    renderSample(out, name + "_count", s.labels, static_cast<double>(count));
+}
+
+
+std::string MetricsRegistry::render() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::string out;
+    std::vector<Sample> samples;
+    for(const std::unique_ptr<Family>& f : m_families) {
+        if(f->series.empty())
+            continue;
+        out += "# HELP " + f->name + " " + f->help + "\n";
+        out += "# TYPE " + f->name + " " + typeName(f->type) + "\n";
+        for(const Series& s : f->series) {
+            if(s.counter) {
+                renderSample(out, f->name, s.labels, static_cast<double>(s.counter->value()));
+            } else if(s.value) {
+                renderSample(out, f->name, s.labels, s.value());
+            } else if(s.histogram) {
+                renderHistogram(out, f->name, s);
+            } else if(s.collect) {
+                samples.clear();
+                s.collect(samples);
+                for(const Sample& sample : samples)
+                    renderSample(out, f->name, sample.labels, sample.value);
+            }
+        }
+    }
+    return out;
+}
+
+
+MetricsServer::MetricsServer(const MetricsRegistry& registry, const std::string& address, int port)
+    : m_registry(registry)
+    , m_listen_fd(-1)
+    , m_stop(false)
+{
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if(inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+        throw std::runtime_error("metrics: bad address " + address);
+
+    m_listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(m_listen_fd < 0)
+        throw std::runtime_error(std::string("metrics: socket: ") + std::strerror(errno));
+
+    // a restarted logger gets its port back straight away
+    int on = 1;
+    ::setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    if(::bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(m_listen_fd, 16) < 0) {
+        const std::string err = std::strerror(errno);
+        ::close(m_listen_fd);
+        throw std::runtime_error("metrics: cannot listen on " + address + ":" + std::to_string(port) + ": " + err);
+    }
+
+    m_thread = std::thread(&MetricsServer::serveLoop, this);
+}
+
+
+MetricsServer::~MetricsServer()
+{
+    m_stop = true;
+    if(m_thread.joinable())
+        m_thread.join();
+    ::close(m_listen_fd);
+}
+
+
+void MetricsServer::serveLoop()
+{
+    pollfd pfd;
+    pfd.fd = m_listen_fd;
+    pfd.events = POLLIN;
+
+    while(!m_stop) {
+        // wake up now and then to notice m_stop
+        if(::poll(&pfd, 1, 100) <= 0)
+            continue;
+        const int fd = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if(fd < 0)
+            continue;
+        serve(fd);
+        ::close(fd);
+    }
+}
+
+
+void MetricsServer::serve(int fd) const
+{
+    // a scraper that stops talking can't hold the thread up for long
+    timeval timeout {1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // the request line and headers; nothing in them changes the answer
+    std::string request;
+    char buf[1024];
+    while(request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if(n <= 0)
+            return;
+        request.append(buf, n);
+    }
+
+    std::string response;
+    if(request.compare(0, 4, "GET ") == 0) {
+        const std::string body = m_registry.render();
+        response = "HTTP/1.1 200 OK\r\n"
+                   "Content-Type: text/plain; version=0.0.4\r\n"
+                   "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                   "Connection: close\r\n\r\n" + body;
+    } else {
+        response = "HTTP/1.1 405 Method Not Allowed\r\n"
+                   "Content-Length: 0\r\n"
+                   "Connection: close\r\n\r\n";
+    }
+
+    std::size_t sent = 0;
+    while(sent < response.size()) {
+        const ssize_t n = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if(n <= 0)
+            return;
+        sent += n;
+    }
+}
+
+
+} // namespace hft
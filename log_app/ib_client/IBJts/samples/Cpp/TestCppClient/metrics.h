@@ -0,0 +1,202 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "latency_histogram.h"
+
+
+namespace hft {
+
+
+/**
+ * @class Counter
+ * @brief a count that only goes up, owned by a MetricsRegistry
+ *
+ * Each counter is updated by one thread only (give every thread its
+ * own, e.g. with a label), so add() is a plain load and store, with
+ * no read-modify-write or shared cache line between threads.
+ */
+class Counter {
+public:
+
+    Counter() : m_value(0) {}
+
+    void add(std::uint64_t n = 1) {
+        m_value.store(m_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+
+    // a cache line to itself (padding rather than alignas, which
+    // plain new doesn't honour before C++17)
+    char m_pad0[64];
+    std::atomic<std::uint64_t> m_value;
+    char m_pad1[64 - sizeof(std::atomic<std::uint64_t>)];
+};
+
+
+/**
+ * @struct Sample
+ * @brief one series of a family, as collect() produces them
+ */
+struct Sample {
+    std::string labels; // e.g. msg_id="46", empty for none
+    double value;
+};
+
+
+/**
+ * @class MetricsRegistry
+ * @brief counters, gauges and histograms, rendered in the Prometheus
+ * text format
+ *
+ * Registering and rendering take a lock, updating never does: owned
+ * counters are updated in place, everything else is read when the
+ * registry is rendered, from the atomics its owner already keeps.
+ * Metrics registered with an owner have to be removed with remove()
+ * before whatever their callbacks read goes away.
+ */
+class MetricsRegistry {
+public:
+
+    enum Type { COUNTER, GAUGE, HISTOGRAM };
+
+    MetricsRegistry() {}
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+
+    /**
+     * @brief the counter with this name and labels, made the first
+     * time it's asked for; it lives as long as the registry
+     * @param labels e.g. instrument="MESH1",type="trade"
+     */
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+
+
+    /**
+     * @brief a counter kept elsewhere, read by value() at render time
+     */
+    void counter(const std::string& name, const std::string& help, const std::string& labels,
+                 std::function<double()> value, const void* owner);
+
+
+    /**
+     * @brief a value that goes up and down, read by value() at render time
+     */
+    void gauge(const std::string& name, const std::string& help, const std::string& labels,
+               std::function<double()> value, const void* owner);
+
+
+    /**
+     * @brief a histogram, rendered with cumulative buckets at bounds
+     * (to within the histogram's resolution)
+     * @param scale multiplies the recorded values, e.g. 1e-9 turns
+     * nanoseconds into seconds
+     */
+    void histogram(const std::string& name, const std::string& help, const std::string& labels,
+                   const LatencyHistogram& histogram, std::vector<double> bounds, double scale,
+                   const void* owner);
+
+
+    /**
+     * @brief series only known at render time, which collect()
+     * appends to the vector it's given
+     */
+    void collect(const std::string& name, const std::string& help, Type type,
+                 std::function<void(std::vector<Sample>&)> collect, const void* owner);
+
+
+    /**
+     * @brief forgets the metrics registered with owner (owned
+     * counters stay)
+     */
+    void remove(const void* owner);
+
+
+    /**
+     * @brief everything, in the Prometheus text exposition format
+     */
+    std::string render() const;
+
+private:
+
+    struct Series {
+        std::string labels;
+        const void* owner;
+        Counter* counter;                                   // owned counters
+        std::function<double()> value;                      // counters and gauges kept elsewhere
+        const LatencyHistogram* histogram;                  // histograms
+        std::vector<double> bounds;
+        double scale;
+        std::function<void(std::vector<Sample>&)> collect;  // collect()
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<Series> series;
+    };
+
+    Family& family(const std::string& name, const std::string& help, Type type);
+
+    static void renderHistogram(std::string& out, const std::string& name, const Series& s);
+
+    mutable std::mutex m_mtx;
+    std::vector<std::unique_ptr<Family>> m_families; // in the order they were registered
+    std::vector<std::unique_ptr<Counter>> m_counters;
+};
+
+
+/**
+ * @class MetricsServer
+ * @brief serves a MetricsRegistry over HTTP, on a thread of its own
+ *
+ * Every GET gets the whole registry back, whatever the path, which
+ * is all a Prometheus scraper needs. One request per connection.
+ */
+class MetricsServer {
+public:
+
+    /**
+     * @brief starts listening
+     * @param address the address to bind, e.g. "127.0.0.1"
+     * @throws std::runtime_error if the port can't be bound
+     */
+    MetricsServer(const MetricsRegistry& registry, const std::string& address, int port);
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * @brief stops listening (a scrape in progress finishes first)
+     */
+    ~MetricsServer();
+
+private:
+
+    void serveLoop();
+    void serve(int fd) const;
+
+    const MetricsRegistry& m_registry;
+    int m_listen_fd;
+    std::atomic<bool> m_stop;
+    std::thread m_thread;
+};
+
+
+} // namespace hft
+
+#endif // METRICS_H
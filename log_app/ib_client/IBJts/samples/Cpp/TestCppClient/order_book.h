@@ -0,0 +1,138 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <cstring> // memmove
+
+
+namespace hft {
+
+
+/* levels kept per side (and requested with reqMktDepth) */
+const unsigned BOOK_DEPTH = 10;
+
+
+/**
+ * @enum BookSide
+ * @brief the side values updateMktDepth() hands over
+ */
+enum BookSide : int {
+    BOOK_ASK = 0,
+    BOOK_BID = 1
+};
+
+
+/**
+ * @enum BookOperation
+ * @brief the operation values updateMktDepth() hands over
+ */
+enum BookOperation : int {
+    BOOK_INSERT = 0,
+    BOOK_UPDATE = 1,
+    BOOK_DELETE = 2
+};
+
+
+/**
+ * @struct BookLevel
+ * @brief one price level
+ */
+struct BookLevel {
+    double price;
+    int size;
+};
+
+
+/**
+ * @class OrderBook
+ * @brief the top BOOK_DEPTH levels of one instrument's book, built
+ * from market depth updates
+ *
+ * Both sides live in fixed arrays inside the object (a few cache
+ * lines), and updates are applied in place, so nothing allocates.
+ * Level 0 is the best bid / best ask.
+ */
+class OrderBook {
+public:
+
+    OrderBook() { clear(); }
+
+
+    /**
+     * @brief applies one updateMktDepth()
+     * @return false (and does nothing) if the update doesn't fit
+     * the book, e.g. a position past BOOK_DEPTH or an unknown side
+     */
+    bool apply(int position, int operation, int side, double price, int size) {
+        if(side != BOOK_ASK && side != BOOK_BID)
+            return false;
+        if(position < 0 || static_cast<unsigned>(position) >= BOOK_DEPTH)
+            return false;
+
+        BookLevel* levels = m_levels[side];
+        unsigned& n = m_size[side];
+        const unsigned pos = static_cast<unsigned>(position);
+
+        switch(operation) {
+        case BOOK_INSERT:
+            if(pos > n)
+                return false;
+            // everything from pos down moves one level back; the last one falls off when full
+            std::memmove(&levels[pos + 1], &levels[pos], (n - pos - (n == BOOK_DEPTH)) * sizeof(BookLevel));
+            if(n < BOOK_DEPTH)
+                n++;
+            break;
+        case BOOK_UPDATE:
+            // an update one past the end is taken as an insert there
+            if(pos > n)
+                return false;
+            if(pos == n)
+                n++;
+            break;
+        case BOOK_DELETE:
+            if(pos >= n)
+                return false;
+            std::memmove(&levels[pos], &levels[pos + 1], (n - pos - 1) * sizeof(BookLevel));
+            n--;
+            return true;
+        default:
+            return false;
+        }
+
+        levels[pos].price = price;
+        levels[pos].size = size;
+        return true;
+    }
+
+
+    /**
+     * @brief empties both sides (after a depth reset)
+     */
+    void clear() {
+        m_size[BOOK_ASK] = m_size[BOOK_BID] = 0;
+    }
+
+
+    /**
+     * @brief number of levels on a side
+     */
+    unsigned levels(int side) const { return m_size[side]; }
+
+
+    /**
+     * @brief one level of a side; position must be below levels(side)
+     */
+    const BookLevel& level(int side, unsigned position) const { return m_levels[side][position]; }
+
+
+    bool empty() const { return m_size[BOOK_ASK] == 0 && m_size[BOOK_BID] == 0; }
+
+private:
+
+    BookLevel m_levels[2][BOOK_DEPTH]; // indexed by BookSide
+    unsigned m_size[2];
+};
+
+
+} // namespace hft
+
+#endif // ORDER_BOOK_H
@@ -0,0 +1,103 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef> // size_t
+
+
+namespace hft {
+
+
+/**
+ * @class SpscRing
+ * @brief bounded, lock-free queue for exactly one producer
+ * thread and one consumer thread
+ *
+ * All slots are allocated up front, so pushing and popping
+ * never touch the heap (as long as T's assignment doesn't).
+ * The capacity is rounded up to a power of two.
+ */
+template<typename T>
+class SpscRing {
+public:
+
+    explicit SpscRing(std::size_t capacity)
+        : m_slots(roundUp(capacity))
+        , m_mask(m_slots.size() - 1)
+        , m_head(0)
+        , m_tail(0)
+    {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+
+    /**
+     * @brief producer side: copies elem in
+     * @return false if the ring is full
+     */
+    bool tryPush(const T& elem) {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if( tail - m_head.load(std::memory_order_acquire) == m_slots.size() )
+            return false;
+        m_slots[tail & m_mask] = elem;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+
+    /**
+     * @brief consumer side: copies the oldest element out
+     * @return false if the ring is empty
+     */
+    bool tryPop(T& elem) {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if( head == m_tail.load(std::memory_order_acquire) )
+            return false;
+        elem = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+
+    /**
+     * @brief number of queued elements (approximate if
+     * read from a third thread)
+     */
+    std::size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+
+    bool empty() const { return size() == 0; }
+
+    std::size_t capacity() const { return m_slots.size(); }
+
+private:
+
+    static std::size_t roundUp(std::size_t n) {
+        std::size_t p = 2;
+        while(p < n)
+            p <<= 1;
+        return p;
+    }
+
+    /* preallocated storage */
+    std::vector<T> m_slots;
+
+    /* capacity - 1 */
+    const std::size_t m_mask;
+
+    /* next slot to read (only written by the consumer) */
+    alignas(64) std::atomic<std::size_t> m_head;
+
+    /* next slot to write (only written by the producer) */
+    alignas(64) std::atomic<std::size_t> m_tail;
+};
+
+
+} // namespace hft
+
+#endif // SPSC_RING_H
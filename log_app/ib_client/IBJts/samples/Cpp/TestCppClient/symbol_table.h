@@ -0,0 +1,98 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <string>
+#include <memory>  // unique_ptr
+#include <atomic>
+#include <cstdint>
+#include <cstring> // memcmp
+
+
+namespace hft {
+
+
+/**
+ * @class SymbolTable
+ * @brief interns short strings (instruments, exchanges, ...)
+ * as small integer ids
+ *
+ * Storage is allocated once, up front. Only one thread may
+ * intern(), but any thread may call name() on an id it was
+ * handed, because a name is fully written before its id is
+ * published.
+ *
+ * Once the table is full, new strings get the id of a reserved
+ * "?" symbol instead, and are counted in overflows().
+ */
+class SymbolTable {
+public:
+
+    explicit SymbolTable(unsigned capacity = 1024)
+        : m_names(new std::string[capacity + 1])
+        , m_capacity(capacity)
+        , m_size(0)
+        , m_overflows(0)
+    {
+        m_names[capacity] = "?";
+    }
+
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+
+    /**
+     * @brief returns the id of s, adding it if it's new, or
+     * overflowId() if it's new and the table is full
+     */
+    unsigned intern(const char* s, std::size_t len) {
+        const unsigned n = m_size.load(std::memory_order_relaxed);
+        for(unsigned id = 0; id < n; ++id) {
+            const std::string& name = m_names[id];
+            if(name.size() == len && std::memcmp(name.data(), s, len) == 0)
+                return id;
+        }
+        if(n == m_capacity) {
+            m_overflows.store(m_overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return m_capacity;
+        }
+        m_names[n].assign(s, len);
+        m_size.store(n + 1, std::memory_order_release);
+        return n;
+    }
+
+
+    unsigned intern(const std::string& s) { return intern(s.data(), s.size()); }
+
+
+    /**
+     * @brief the string behind an id
+     */
+    const std::string& name(unsigned id) const { return m_names[id]; }
+
+
+    unsigned size() const { return m_size.load(std::memory_order_acquire); }
+
+
+    /**
+     * @brief the id of the "?" symbol handed out once the table is full
+     */
+    unsigned overflowId() const { return m_capacity; }
+
+
+    /**
+     * @brief how many times intern() handed out overflowId()
+     */
+    std::uint64_t overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+
+private:
+
+    std::unique_ptr<std::string[]> m_names;
+    const unsigned m_capacity;
+    std::atomic<unsigned> m_size;
+    std::atomic<std::uint64_t> m_overflows;
+};
+
+
+} // namespace hft
+
+#endif // SYMBOL_TABLE_H
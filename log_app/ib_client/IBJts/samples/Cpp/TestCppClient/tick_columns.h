@@ -0,0 +1,133 @@
+#ifndef TICK_COLUMNS_H
+#define TICK_COLUMNS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef> // size_t
+
+
+namespace hft {
+
+
+/* the most columns any tick table has (changing it changes the spool's record layout) */
+const unsigned MAX_COLUMNS = 9;
+
+
+/**
+ * @enum ColumnKind
+ * @brief what a column holds, which decides how it's written out
+ */
+enum ColumnKind : unsigned char {
+    COL_TIME,   // nanoseconds since the epoch, written as a datetime(6)
+    COL_DOUBLE, // prices
+    COL_INT,    // sizes, counts, codes
+    COL_SYMBOL  // SymbolTable id, written as a string
+};
+
+
+/**
+ * @struct ColumnSpec
+ * @brief one column of a destination table
+ */
+struct ColumnSpec {
+    std::string name;
+    ColumnKind kind;
+};
+
+
+/**
+ * @struct TableSpec
+ * @brief a destination table and its columns, in insert order
+ */
+struct TableSpec {
+    std::string name;
+    std::vector<ColumnSpec> columns;
+};
+
+
+/**
+ * @union Cell
+ * @brief one value; which member is live depends on the ColumnKind
+ */
+union Cell {
+    std::int64_t i; // COL_TIME, COL_INT, COL_SYMBOL
+    double d;       // COL_DOUBLE
+};
+
+
+/**
+ * @struct TickRow
+ * @brief one row bound for one table, as it travels through queues
+ */
+struct TickRow {
+    unsigned char table;
+    Cell cells[MAX_COLUMNS];
+};
+
+
+/**
+ * @class TickColumns
+ * @brief fixed-capacity struct-of-arrays storage for the pending
+ * rows of one table
+ *
+ * All the memory is allocated in the constructor and clear() keeps
+ * it, so appending never allocates. Column c is contiguous, which
+ * is what the flushing code walks.
+ */
+class TickColumns {
+public:
+
+    TickColumns(const TableSpec* spec, std::size_t capacity)
+        : m_spec(spec)
+        , m_capacity(capacity)
+        , m_size(0)
+        , m_cells(spec->columns.size() * capacity)
+    {
+    }
+
+    /**
+     * @brief copies a row in
+     * @return false (and does nothing) if already full
+     */
+    bool append(const Cell* cells) {
+        if(m_size == m_capacity)
+            return false;
+        const unsigned ncols = m_spec->columns.size();
+        for(unsigned c = 0; c < ncols; ++c)
+            m_cells[c * m_capacity + m_size] = cells[c];
+        m_size++;
+        return true;
+    }
+
+    /**
+     * @brief the first value of column c (values are contiguous)
+     */
+    const Cell* column(unsigned c) const { return &m_cells[c * m_capacity]; }
+
+    const Cell& at(std::size_t row, unsigned c) const { return m_cells[c * m_capacity + row]; }
+
+    const TableSpec& spec() const { return *m_spec; }
+
+    std::size_t size() const { return m_size; }
+
+    std::size_t capacity() const { return m_capacity; }
+
+    bool empty() const { return m_size == 0; }
+
+    bool full() const { return m_size == m_capacity; }
+
+    void clear() { m_size = 0; }
+
+private:
+
+    const TableSpec* m_spec;
+    std::size_t m_capacity;
+    std::size_t m_size;
+    std::vector<Cell> m_cells; // column-major, each column m_capacity long
+};
+
+
+} // namespace hft
+
+#endif // TICK_COLUMNS_H
@@ -0,0 +1,228 @@
+#include "tick_spool.h"
+
+#include <algorithm> // sort
+#include <chrono>
+#include <cerrno>
+#include <cstdio> // snprintf
+#include <cstring> // memcpy, memset, strerror
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h> // open
+#include <unistd.h> // write, read, fdatasync, close
+#include <dirent.h> // opendir
+#include <sys/stat.h> // mkdir
+
+
+namespace hft{
+
+
+static const char* OPEN_SUFFIX = ".open";
+static const char* SEALED_SUFFIX = ".bin";
+
+
+static bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+
+/* names of the directory's files that end in suffix, sorted */
+static std::vector<std::string> listFiles(const std::string& dir, const std::string& suffix) {
+    std::vector<std::string> names;
+    DIR* d = opendir(dir.c_str());
+    if(!d)
+        return names;
+    while(dirent* ent = readdir(d)) {
+        std::string name(ent->d_name);
+        if(name.compare(0, 6, "spool_") == 0 && endsWith(name, suffix))
+            names.push_back(dir + "/" + name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+
+/* flushes a directory entry (a rename or a new file) to disk */
+static void syncDir(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if(fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+
+TickSpool::TickSpool(const std::string& dir, std::size_t segmentBytes)
+    : m_dir(dir)
+    , m_segment_bytes(segmentBytes)
+    , m_fd(-1)
+    , m_bytes(0)
+    , m_buf(256 * sizeof(SpoolRecord))
+    , m_used(0)
+    , m_rows(0)
+{
+    if(::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        throw std::runtime_error("could not create spool directory " + dir + ": " + std::strerror(errno) + "\n");
+
+    // whatever was open when we last stopped is as complete as it'll get
+    for(const std::string& path : listFiles(dir, OPEN_SUFFIX)) {
+        std::string sealed = path.substr(0, path.size() - std::strlen(OPEN_SUFFIX)) + SEALED_SUFFIX;
+        ::rename(path.c_str(), sealed.c_str());
+    }
+    syncDir(dir);
+}
+
+
+TickSpool::~TickSpool()
+{
+    try{
+        seal();
+    }catch(const std::exception& e){
+        std::cerr << "spool problem: " << e.what() << "\n";
+    }
+}
+
+
+void TickSpool::open()
+{
+    const long long nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::system_clock::now().time_since_epoch()).count();
+    char name[64];
+    std::snprintf(name, sizeof(name), "/spool_%020lld", nanos);
+    m_path = m_dir + name;
+    m_fd = ::open((m_path + OPEN_SUFFIX).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(m_fd < 0)
+        throw std::runtime_error("could not open spool segment " + m_path + ": " + std::strerror(errno) + "\n");
+    m_bytes = 0;
+}
+
+
+void TickSpool::writeOut()
+{
+    std::size_t done = 0;
+    while(done < m_used) {
+        ssize_t n = ::write(m_fd, &m_buf[done], m_used - done);
+        if(n < 0) {
+            if(errno == EINTR)
+                continue;
+            throw std::runtime_error("could not write spool segment " + m_path + ": " + std::strerror(errno) + "\n");
+        }
+        done += n;
+    }
+    m_used = 0;
+}
+
+
+std::size_t TickSpool::append(unsigned char table, const TickColumns& rows, const SymbolTable& symbols)
+{
+    const std::vector<ColumnSpec>& columns = rows.spec().columns;
+
+    SpoolRecord rec;
+    std::memset(&rec, 0, sizeof(rec));
+    rec.magic = SPOOL_MAGIC;
+    rec.table = table;
+
+    for(std::size_t row = 0; row < rows.size(); ++row) {
+
+        if(m_fd < 0)
+            open();
+
+        for(unsigned c = 0; c < columns.size(); ++c) {
+            rec.cells[c] = rows.at(row, c);
+            if(columns[c].kind == COL_SYMBOL) {
+                const std::string& name = symbols.name(static_cast<unsigned>(rec.cells[c].i));
+                const std::size_t len = std::min<std::size_t>(name.size(), SPOOL_SYMBOL_LEN - 1);
+                std::memcpy(rec.text[c], name.data(), len);
+                std::memset(rec.text[c] + len, 0, SPOOL_SYMBOL_LEN - len);
+            }
+        }
+
+        if(m_used + sizeof(rec) > m_buf.size())
+            writeOut();
+        std::memcpy(&m_buf[m_used], &rec, sizeof(rec));
+        m_used += sizeof(rec);
+        m_bytes += sizeof(rec);
+        m_rows++;
+
+        if(m_bytes >= m_segment_bytes)
+            seal();
+    }
+
+    return rows.size();
+}
+
+
+void TickSpool::sync()
+{
+    if(m_fd < 0)
+        return;
+    writeOut();
+    if(::fdatasync(m_fd) != 0)
+        throw std::runtime_error("could not sync spool segment " + m_path + ": " + std::strerror(errno) + "\n");
+}
+
+
+void TickSpool::seal()
+{
+    if(m_fd < 0)
+        return;
+    sync();
+    ::close(m_fd);
+    m_fd = -1;
+    if(::rename((m_path + OPEN_SUFFIX).c_str(), (m_path + SEALED_SUFFIX).c_str()) != 0)
+        throw std::runtime_error("could not seal spool segment " + m_path + ": " + std::strerror(errno) + "\n");
+    syncDir(m_dir);
+}
+
+
+std::vector<std::string> TickSpool::sealedSegments() const
+{
+    return listFiles(m_dir, SEALED_SUFFIX);
+}
+
+
+SpoolReader::SpoolReader(const std::string& path)
+    : m_fd(::open(path.c_str(), O_RDONLY))
+{
+    if(m_fd < 0)
+        throw std::runtime_error("could not open spool segment " + path + ": " + std::strerror(errno) + "\n");
+}
+
+
+SpoolReader::~SpoolReader()
+{
+    ::close(m_fd);
+}
+
+
+/* reads up to len bytes, fewer only at the end of the file */
+static std::size_t readFully(int fd, void* buf, std::size_t len)
+{
+    char* dst = static_cast<char*>(buf);
+    std::size_t got = 0;
+    while(got < len) {
+        ssize_t n = ::read(fd, dst + got, len - got);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            break;
+        got += n;
+    }
+    return got;
+}
+
+
+bool SpoolReader::next(SpoolRecord& rec)
+{
+    const std::size_t got = readFully(m_fd, &rec, sizeof(rec));
+    if(got == 0)
+        return false;
+    if(got < sizeof(rec) || rec.magic != TickSpool::SPOOL_MAGIC) {
+        std::cerr << "spool segment ends in a damaged record, skipping the rest\n";
+        return false;
+    }
+    return true;
+}
+
+
+} // namespace hft
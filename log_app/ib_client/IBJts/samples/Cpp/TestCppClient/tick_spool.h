@@ -0,0 +1,150 @@
+#ifndef TICK_SPOOL_H
+#define TICK_SPOOL_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef> // size_t
+
+#include "symbol_table.h"
+#include "tick_columns.h"
+
+
+namespace hft {
+
+
+/* longest symbol a spool record keeps (the tables use VARCHAR(15)) */
+const unsigned SPOOL_SYMBOL_LEN = 16;
+
+
+/**
+ * @struct SpoolRecord
+ * @brief one row as it sits on disk. Symbols are stored as text
+ * because SymbolTable ids don't survive a restart.
+ */
+struct SpoolRecord {
+    std::uint32_t magic;  // SPOOL_MAGIC, catches torn writes
+    unsigned char table;  // TableId
+    unsigned char pad[3];
+    Cell cells[MAX_COLUMNS];
+    char text[MAX_COLUMNS][SPOOL_SYMBOL_LEN]; // COL_SYMBOL columns, NUL padded
+};
+
+
+/**
+ * @class TickSpool
+ * @brief append-only, on-disk queue of rows that couldn't be written
+ * to the database
+ *
+ * Rows are appended to an open segment ("spool_<nanos>.open") through
+ * a preallocated buffer, so appending doesn't allocate. sync() makes
+ * everything appended so far durable with one fdatasync. Once a
+ * segment is sealed it's renamed to ".bin", and from then on it belongs
+ * to whoever replays it. Only one thread may append/sync/seal, but
+ * sealedSegments() and SpoolReader can be used from any thread.
+ */
+class TickSpool {
+public:
+
+    /**
+     * @brief creates dir if needed and seals any segment a previous
+     * run left open
+     * @param dir where the segments live
+     * @param segmentBytes seal a segment once it gets this big
+     */
+    TickSpool(const std::string& dir, std::size_t segmentBytes);
+
+    TickSpool(const TickSpool&) = delete;
+    TickSpool& operator=(const TickSpool&) = delete;
+
+    /**
+     * @brief seals the open segment
+     */
+    ~TickSpool();
+
+
+    /**
+     * @brief appends every row of one table
+     * @return the number of rows appended
+     */
+    std::size_t append(unsigned char table, const TickColumns& rows, const SymbolTable& symbols);
+
+
+    /**
+     * @brief writes out the buffer and fdatasyncs the open segment
+     */
+    void sync();
+
+
+    /**
+     * @brief syncs and closes the open segment and hands it over for
+     * replay (does nothing if there isn't one)
+     */
+    void seal();
+
+
+    /**
+     * @brief sealed segments, oldest first
+     */
+    std::vector<std::string> sealedSegments() const;
+
+
+    /* rows appended since construction */
+    std::uint64_t rowsAppended() const { return m_rows; }
+
+    /* "POL2". Segments from before MAX_COLUMNS grew were tagged "POOL"
+     * and hold shorter records; a different tag makes them stop at their
+     * first record as damaged instead of being misread. */
+    static const std::uint32_t SPOOL_MAGIC = 0x324c4f50;
+
+private:
+
+    void open();
+
+    void writeOut();
+
+    std::string m_dir;
+    std::size_t m_segment_bytes;
+
+    /* the open segment, or -1 */
+    int m_fd;
+    std::string m_path;
+    std::size_t m_bytes;
+
+    /* records waiting to be written */
+    std::vector<char> m_buf;
+    std::size_t m_used;
+
+    std::uint64_t m_rows;
+};
+
+
+/**
+ * @class SpoolReader
+ * @brief reads a sealed segment back a record at a time, stopping
+ * at the first torn or partial record
+ */
+class SpoolReader {
+public:
+
+    explicit SpoolReader(const std::string& path);
+
+    SpoolReader(const SpoolReader&) = delete;
+    SpoolReader& operator=(const SpoolReader&) = delete;
+
+    ~SpoolReader();
+
+    /**
+     * @return false at the end of the segment
+     */
+    bool next(SpoolRecord& rec);
+
+private:
+
+    int m_fd;
+};
+
+
+} // namespace hft
+
+#endif // TICK_SPOOL_H
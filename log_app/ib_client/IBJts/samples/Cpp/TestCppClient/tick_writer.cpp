@@ -3,21 +3,79 @@
 #include <fstream> //ifstream
 #include <sstream> //stringstream
 #include <memory> // unique_ptr
+#include <algorithm> // min
+#include <cstdlib> // mkstemp
+#include <cerrno>
+#include <cstring> // strerror
+#include <unistd.h> // write, close, unlink
 #include <cppconn/prepared_statement.h> // preparedStatement
+#include <cppconn/exception.h> // SQLException
+#include <cppconn/warning.h> // SQLWarning
 #include <boost/algorithm/string.hpp>
 
 
 namespace hft{
 
 
+/* what TickWriter::internRepeated() starts from */
+static const unsigned NO_SYMBOL = ~0u;
+
+
+/* time points travel through the buffers as nanoseconds since the epoch */
+static std::int64_t toNanos(const TimePoint& time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+
 inline std::string toString(const TimePoint& time) {
-    std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch());
-    std::chrono::seconds s = std::chrono::duration_cast<std::chrono::seconds>(ms);
-    std::time_t t = s.count();
-    std::size_t fractional_seconds = ms.count() %1000;
-    char cstr[100];
-    std::strftime(cstr, sizeof(cstr), "%Y-%m-%d %H:%M:%OS", std::localtime(&t));
-    return std::string(cstr) + std::string(".") + std::to_string(fractional_seconds);
+    char cstr[TIMESTAMP_LEN];
+    return std::string(cstr, formatTimestamp(cstr, toNanos(time)));
+}
+
+
+/* "INSERT INTO db.table (col, ...) VALUES " */
+static std::string insertPrefix(const std::string& database, const TableSpec& table, const char* verb = "INSERT") {
+    std::string prefix = std::string(verb) + " INTO " + database + "." + table.name + " (";
+    for(unsigned c = 0; c < table.columns.size(); ++c) {
+        if(c > 0)
+            prefix += ", ";
+        prefix += table.columns[c].name;
+    }
+    return prefix + ") VALUES ";
+}
+
+
+/* errors after which the server no longer knows our prepared statements */
+static bool preparedStatementsLost(int error_code) {
+    return error_code == 2006    // CR_SERVER_GONE_ERROR
+        || error_code == 2013    // CR_SERVER_LOST
+        || error_code == 1243;   // ER_UNKNOWN_STMT_HANDLER (we were reconnected)
+}
+
+
+/* counts a statement's warnings and logs the first. The duplicates IGNORE
+ * skipped aren't counted, they show up as skipped rows. (The connector
+ * only asks the server for the list when the statement raised any, and
+ * the server keeps at most max_error_count of them.) */
+static unsigned countWarnings(const sql::SQLWarning* warning, const std::string& table) {
+    unsigned count = 0;
+    for(; warning; warning = warning->getNext()) {
+        if(warning->getErrorCode() == 1062) // ER_DUP_ENTRY
+            continue;
+        if(count == 0)
+            std::cerr << "warning writing " << table << ": " << warning->getMessage().asStdString() << "\n";
+        count++;
+    }
+    return count;
+}
+
+
+/* looks up an optional key, falling back on a default */
+static std::string propertyOr(const std::map<std::string, std::string>& properties,
+                              const std::string& key,
+                              const std::string& fallback) {
+    auto iter = properties.find(key);
+    return iter == properties.end() || iter->second.empty() ? fallback : iter->second;
 }
 
 
@@ -46,15 +104,82 @@ MySqlConfig MySqlConfig::readConfigFromFile(const std::string &path) {
         std::cerr << "\nmysql file not good\n";
     }
 
-    UserPassCredentials credentials {properties.at("user"), properties.at("password")};
-    return MySqlConfig {
-        properties.at("database"), 
-        properties.at("orderTable"),
-        properties.at("tradeTable"),
-        properties.at("host"), 
-        std::stoi(properties.at("port")), 
-        credentials
-    };
+    MySqlConfig config;
+    config.database    = properties.at("database");
+    config.orderTable  = properties.at("orderTable");
+    config.tradeTable  = properties.at("tradeTable");
+    config.midPointTable = propertyOr(properties, "midPointTable", "mid_point_data");
+    config.depthTable    = propertyOr(properties, "depthTable", "depth_data");
+    config.barTable      = propertyOr(properties, "barTable", "bar_data");
+
+    // optional market depth parameters
+    std::string depth = boost::algorithm::to_lower_copy(propertyOr(properties, "depthMode", "deltas"));
+    if(depth == "deltas")
+        config.depthMode = DEPTH_DELTAS;
+    else if(depth == "snapshots")
+        config.depthMode = DEPTH_SNAPSHOTS;
+    else if(depth == "both")
+        config.depthMode = DEPTH_BOTH;
+    else
+        throw std::runtime_error("unknown depthMode " + depth + "\n");
+    config.depthSnapshotMs = std::stoul(propertyOr(properties, "depthSnapshotMs", "1000"));
+    config.depthSnapshotTable = propertyOr(properties, "depthSnapshotTable", "depth_snapshot_data");
+
+    // optional bars built from trades
+    std::vector<std::string> intervals;
+    std::string barIntervals = propertyOr(properties, "barIntervals", "");
+    boost::algorithm::split(intervals, barIntervals, boost::algorithm::is_any_of(", "), boost::algorithm::token_compress_on);
+    for(const std::string& interval : intervals) {
+        if(interval.empty())
+            continue;
+        config.barIntervals.push_back(std::stoul(interval));
+        if(config.barIntervals.back() == 0)
+            throw std::runtime_error("barIntervals must be positive\n");
+    }
+    config.barTablePrefix = propertyOr(properties, "barTablePrefix", "trade_bars_");
+    config.host        = properties.at("host");
+    config.port        = std::stoi(properties.at("port"));
+    config.credentials = UserPassCredentials {properties.at("user"), properties.at("password")};
+
+    // optional batching parameters
+    std::string mode = boost::algorithm::to_lower_copy(propertyOr(properties, "flushMode", "multirow"));
+    if(mode == "multirow")
+        config.flushMode = FLUSH_MULTI_ROW;
+    else if(mode == "perrow")
+        config.flushMode = FLUSH_PER_ROW;
+    else if(mode == "prepared")
+        config.flushMode = FLUSH_PREPARED;
+    else
+        throw std::runtime_error("unknown flushMode " + mode + "\n");
+    config.maxRowsPerInsert = std::stoul(propertyOr(properties, "maxRowsPerInsert", "1000"));
+    config.maxInsertBytes   = std::stoul(propertyOr(properties, "maxInsertBytes", "1048576"));
+    if(config.maxRowsPerInsert == 0 || config.maxInsertBytes == 0)
+        throw std::runtime_error("maxRowsPerInsert and maxInsertBytes must be positive\n");
+
+    // optional writer thread parameters
+    config.asyncWriter     = std::stoi(propertyOr(properties, "asyncWriter", "0")) != 0;
+    config.queueCapacity   = std::stoul(propertyOr(properties, "queueCapacity", "65536"));
+    config.flushIntervalMs = std::stoul(propertyOr(properties, "flushIntervalMs", "250"));
+    config.asyncFlushRows  = std::stoul(propertyOr(properties, "asyncFlushRows", "0"));
+    std::string policy = boost::algorithm::to_lower_copy(propertyOr(properties, "queueFullPolicy", "block"));
+    if(policy == "block")
+        config.dropWhenFull = false;
+    else if(policy == "drop")
+        config.dropWhenFull = true;
+    else
+        throw std::runtime_error("unknown queueFullPolicy " + policy + "\n");
+    config.bufferCapacity = std::stoul(propertyOr(properties, "bufferCapacity", "16384"));
+    if(config.bufferCapacity == 0)
+        throw std::runtime_error("bufferCapacity must be positive\n");
+    config.bulkLoadRows = std::stoul(propertyOr(properties, "bulkLoadRows", "0"));
+    if(config.bulkLoadRows > config.bufferCapacity)
+        throw std::runtime_error("bulkLoadRows must not be more than bufferCapacity\n");
+    config.bulkLoadDir = propertyOr(properties, "bulkLoadDir", "/tmp");
+    config.spoolDir = propertyOr(properties, "spoolDir", "");
+    config.spoolSegmentBytes = std::stoul(propertyOr(properties, "spoolSegmentBytes", "67108864"));
+    config.spoolRetryMs = std::stoul(propertyOr(properties, "spoolRetryMs", "1000"));
+
+    return config;
 }
 
 TickWriter::TickWriter(const std::string& mysql_cnfg_file,
@@ -63,31 +188,160 @@ TickWriter::TickWriter(const std::string& mysql_cnfg_file,
                        bool printing,
                        bool reconnect)
     : FutSymsConfig(sym_table_file)
+    , m_msql_config(MySqlConfig::readConfigFromFile(mysql_cnfg_file))
     , m_printing(printing)
+    , m_symbols(1024)
+    , m_last_exchange_symbol(NO_SYMBOL)
+    , m_last_market_maker_symbol(NO_SYMBOL)
+    , m_num_reprepares(0)
+    , m_spooling(false)
+    , m_db_back(false)
+    , m_spooled(0)
+    , m_replayed(0)
     , m_num_data(0)
     , m_auto_flush_every(autoFlushEvery)
+    , m_last_flush {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+    , m_db_errors(0)
+    , m_db_warnings(0)
+    , m_skipped(0)
+    , m_reconnects(0)
+    , m_trace(nullptr)
+    , m_num_flushes(0)
+    , m_queue(m_msql_config.asyncWriter ? m_msql_config.queueCapacity : 1)
+    , m_enqueued(0)
+    , m_dropped(0)
+    , m_stalls(0)
+    , m_flush_requested(false)
+    , m_pending_orders(0)
+    , m_pending_trades(0)
+    , m_stop(false)
+    , m_writer_idle(false)
 { 
 
-    // read in mysql config file
-    m_msql_config = MySqlConfig::readConfigFromFile(mysql_cnfg_file); 
+    // describe the tables
+    m_tables.resize(NUM_TABLES);
+    m_tables[BID_ASK_TABLE] = TableSpec {m_msql_config.orderTable, {
+        {"dt", COL_TIME}, 
+        {"bidPrice", COL_DOUBLE}, 
+        {"askPrice", COL_DOUBLE}, 
+        {"bidSize", COL_INT}, 
+        {"askSize", COL_INT}, 
+        {"instrument", COL_SYMBOL}}};
+    m_tables[TRADE_TABLE] = TableSpec {m_msql_config.tradeTable, {
+        {"dt", COL_TIME}, 
+        {"price", COL_DOUBLE}, 
+        {"size", COL_INT}, 
+        {"exchange", COL_SYMBOL}, 
+        {"instrument", COL_SYMBOL}}};
+    m_tables[MID_POINT_TABLE] = TableSpec {m_msql_config.midPointTable, {
+        {"dt", COL_TIME}, 
+        {"midPoint", COL_DOUBLE}, 
+        {"instrument", COL_SYMBOL}}};
+    m_tables[DEPTH_TABLE] = TableSpec {m_msql_config.depthTable, {
+        {"dt", COL_TIME}, 
+        {"position", COL_INT}, 
+        {"operation", COL_INT}, 
+        {"side", COL_INT}, 
+        {"price", COL_DOUBLE}, 
+        {"size", COL_INT}, 
+        {"marketMaker", COL_SYMBOL}, 
+        {"instrument", COL_SYMBOL}}};
+    m_tables[BAR_TABLE] = TableSpec {m_msql_config.barTable, {
+        {"dt", COL_TIME}, 
+        {"open", COL_DOUBLE}, 
+        {"high", COL_DOUBLE}, 
+        {"low", COL_DOUBLE}, 
+        {"close", COL_DOUBLE}, 
+        {"volume", COL_INT}, 
+        {"wap", COL_DOUBLE}, 
+        {"count", COL_INT}, 
+        {"instrument", COL_SYMBOL}}};
+    m_tables[DEPTH_SNAPSHOT_TABLE] = TableSpec {m_msql_config.depthSnapshotTable, {
+        {"dt", COL_TIME}, 
+        {"side", COL_INT}, 
+        {"position", COL_INT}, 
+        {"price", COL_DOUBLE}, 
+        {"size", COL_INT}, 
+        {"instrument", COL_SYMBOL}}};
+    for(unsigned seconds : m_msql_config.barIntervals) {
+        m_tables.push_back(TableSpec {m_msql_config.barTablePrefix + BarBuilder::label(seconds), {
+            {"dt", COL_TIME}, 
+            {"open", COL_DOUBLE}, 
+            {"high", COL_DOUBLE}, 
+            {"low", COL_DOUBLE}, 
+            {"close", COL_DOUBLE}, 
+            {"volume", COL_INT}, 
+            {"vwap", COL_DOUBLE}, 
+            {"count", COL_INT}, 
+            {"instrument", COL_SYMBOL}}});
+        m_bar_builders.push_back(BarBuilder(seconds, size()));
+    }
+
+    // preallocate the buffer so adding ticks never allocates
+    for(const TableSpec& spec : m_tables)
+        m_pending.tables.push_back(TickColumns(&spec, m_msql_config.bufferCapacity));
+
+    // instruments go in first, in the same order as the symbol file
+    for(unsigned int i = 0; i < size(); ++i) {
+        const unsigned symbol = m_symbols.intern(loc_syms(i));
+        if(symbol == m_symbols.overflowId())
+            throw std::runtime_error("too many instruments for the symbol table\n");
+        m_instrument_symbols.push_back(symbol);
+        if(symbol == m_symbol_instruments.size())
+            m_symbol_instruments.push_back(i);
+    }
+
+    // one book per instrument, whether it gets depth or not
+    m_books.resize(size());
+    m_last_snapshot.resize(size(), 0);
+    m_book_changed.resize(size(), false);
 
     // database stuff
     // configure driver and connection
     m_driver = get_driver_instance();
+    m_conn = connect(reconnect);
+
+    // the replay thread picks up anything a previous run spooled, too
+    if(!m_msql_config.spoolDir.empty()) {
+        m_spool.reset(new TickSpool(m_msql_config.spoolDir, m_msql_config.spoolSegmentBytes));
+        m_replayer = std::thread(&TickWriter::replayLoop, this);
+    }
+
+    // from now on the writer thread owns the buffers and the connection
+    if(m_msql_config.asyncWriter)
+        m_writer = std::thread(&TickWriter::writerLoop, this);
+}
+
+
+sql::Connection* TickWriter::connect(bool reconnect) const
+{
     std::string conn_str = "tcp://" 
                          + m_msql_config.host + ":" 
                          + std::to_string(m_msql_config.port);
-    m_conn = m_driver->connect(conn_str, 
-                               m_msql_config.credentials.username, 
-                               m_msql_config.credentials.password);
-    m_conn->setClientOption("OPT_RECONNECT", &reconnect); 
-    m_conn->setSchema(m_msql_config.database);
-
+    sql::Connection* conn = m_driver->connect(conn_str, 
+                                              m_msql_config.credentials.username, 
+                                              m_msql_config.credentials.password);
+    conn->setClientOption("OPT_RECONNECT", &reconnect); 
+    if(m_msql_config.bulkLoadRows > 0) {
+        // LOAD DATA LOCAL needs the client's permission too (server: local_infile=1)
+        bool local_infile = true;
+        conn->setClientOption("OPT_LOCAL_INFILE", &local_infile);
+    }
+    conn->setSchema(m_msql_config.database);
+    return conn;
 }
        
 
 TickWriter::~TickWriter()
 {
+    // the writer thread drains whatever is left before exiting
+    m_stop = true;
+    wakeWriter();
+    if(m_writer.joinable())
+        m_writer.join();
+    if(m_replayer.joinable())
+        m_replayer.join();
+    m_prepared.clear(); // statements must go before their connection
     delete m_conn;
 }
 
@@ -98,13 +352,23 @@ void TickWriter::addBidAsk(
         double askPrice, 
         int bidSize, 
         int askSize,
-        const std::string& instrument)
+        InstrumentId instrument)
 {
-    m_order_bundle.push_back(BidAsk{dt, bidPrice, askPrice, bidSize, askSize, instrument });
-    m_num_data++;
-    if( m_auto_flush_every > 0){
-        if( m_num_data % m_auto_flush_every == 0)
-            flushToDB(); 
+    TickRow row;
+    row.table = BID_ASK_TABLE;
+    row.cells[0].i = toNanos(dt);
+    row.cells[1].d = bidPrice;
+    row.cells[2].d = askPrice;
+    row.cells[3].i = bidSize;
+    row.cells[4].i = askSize;
+    row.cells[5].i = m_instrument_symbols.at(instrument);
+    submit(row);
+
+    // quotes move the clock on, too
+    for(unsigned b = 0; b < m_bar_builders.size(); ++b) {
+        m_bar_builders[b].advance(instrument, row.cells[0].i, [this, b](unsigned inst, const TradeBar& bar) {
+            submitBar(NUM_TABLES + b, inst, bar);
+        });
     }
 }
 
@@ -114,90 +378,875 @@ void TickWriter::addTrade(
         double price, 
         int size, 
         const std::string& exchange,
-        const std::string& instrument)
+        InstrumentId instrument)
+{
+    addTrade(dt, price, size, exchange.data(), exchange.size(), instrument);
+}
+
+
+void TickWriter::addTrade(
+        const TimePoint& dt,  
+        double price, 
+        int size, 
+        const char* exchange,
+        std::size_t len,
+        InstrumentId instrument)
+{
+    TickRow row;
+    row.table = TRADE_TABLE;
+    row.cells[0].i = toNanos(dt);
+    row.cells[1].d = price;
+    row.cells[2].i = size;
+    row.cells[3].i = internRepeated(m_last_exchange, m_last_exchange_symbol, exchange, len);
+    row.cells[4].i = m_instrument_symbols.at(instrument);
+    submit(row);
+
+    buildBars(row.cells[0].i, price, size, instrument);
+}
+
+
+void TickWriter::buildBars(std::int64_t nanos, double price, int size, InstrumentId instrument)
+{
+    for(unsigned b = 0; b < m_bar_builders.size(); ++b) {
+        m_bar_builders[b].trade(instrument, nanos, price, size, [this, b](unsigned inst, const TradeBar& bar) {
+            submitBar(NUM_TABLES + b, inst, bar);
+        });
+    }
+}
+
+
+void TickWriter::closeBars(const TimePoint& now)
+{
+    const std::int64_t nanos = toNanos(now);
+    for(unsigned b = 0; b < m_bar_builders.size(); ++b) {
+        m_bar_builders[b].advance(nanos, [this, b](unsigned inst, const TradeBar& bar) {
+            submitBar(NUM_TABLES + b, inst, bar);
+        });
+    }
+}
+
+
+void TickWriter::submitBar(unsigned table, InstrumentId instrument, const TradeBar& bar)
+{
+    TickRow row;
+    row.table = table;
+    row.cells[0].i = bar.start;
+    row.cells[1].d = bar.open;
+    row.cells[2].d = bar.high;
+    row.cells[3].d = bar.low;
+    row.cells[4].d = bar.close;
+    row.cells[5].i = bar.volume;
+    row.cells[6].d = bar.vwap();
+    row.cells[7].i = bar.count;
+    row.cells[8].i = m_instrument_symbols[instrument];
+    submit(row);
+}
+
+
+void TickWriter::addMidPoint(
+        const TimePoint& dt,  
+        double midPoint, 
+        InstrumentId instrument)
 {
-    m_trade_bundle.push_back(Trade{dt, price, size, exchange, instrument });    
+    TickRow row;
+    row.table = MID_POINT_TABLE;
+    row.cells[0].i = toNanos(dt);
+    row.cells[1].d = midPoint;
+    row.cells[2].i = m_instrument_symbols.at(instrument);
+    submit(row);
+}
+
+
+void TickWriter::addDepth(
+        const TimePoint& dt,  
+        int position, 
+        int operation, 
+        int side, 
+        double price, 
+        int size, 
+        const char* marketMaker,
+        std::size_t len,
+        InstrumentId instrument)
+{
+    const std::int64_t nanos = toNanos(dt);
+
+    if(m_books.at(instrument).apply(position, operation, side, price, size))
+        m_book_changed[instrument] = true;
+
+    if(m_msql_config.depthMode != DEPTH_SNAPSHOTS) {
+        TickRow row;
+        row.table = DEPTH_TABLE;
+        row.cells[0].i = nanos;
+        row.cells[1].i = position;
+        row.cells[2].i = operation;
+        row.cells[3].i = side;
+        row.cells[4].d = price;
+        row.cells[5].i = size;
+        row.cells[6].i = internRepeated(m_last_market_maker, m_last_market_maker_symbol, marketMaker, len);
+        row.cells[7].i = m_instrument_symbols[instrument];
+        submit(row);
+    }
+
+    if(m_msql_config.depthMode != DEPTH_DELTAS && m_book_changed[instrument]
+       && nanos - m_last_snapshot[instrument] >= m_msql_config.depthSnapshotMs * 1000000LL)
+        snapshotBook(nanos, instrument);
+}
+
+
+void TickWriter::snapshotBooks(const TimePoint& now)
+{
+    if(m_msql_config.depthMode == DEPTH_DELTAS)
+        return;
+    const std::int64_t nanos = toNanos(now);
+    for(InstrumentId i = 0; i < m_books.size(); ++i) {
+        if(m_book_changed[i] && nanos - m_last_snapshot[i] >= m_msql_config.depthSnapshotMs * 1000000LL)
+            snapshotBook(nanos, i);
+    }
+}
+
+
+void TickWriter::snapshotBook(std::int64_t nanos, InstrumentId instrument)
+{
+    const OrderBook& book = m_books[instrument];
+    TickRow row;
+    row.table = DEPTH_SNAPSHOT_TABLE;
+    row.cells[0].i = nanos;
+    row.cells[5].i = m_instrument_symbols[instrument];
+    for(int side = BOOK_ASK; side <= BOOK_BID; ++side) {
+        row.cells[1].i = side;
+        for(unsigned pos = 0; pos < book.levels(side); ++pos) {
+            row.cells[2].i = pos;
+            row.cells[3].d = book.level(side, pos).price;
+            row.cells[4].i = book.level(side, pos).size;
+            submit(row);
+        }
+    }
+    m_last_snapshot[instrument] = nanos;
+    m_book_changed[instrument] = false;
+}
+
+
+const OrderBook& TickWriter::book(InstrumentId instrument) const
+{
+    return m_books.at(instrument);
+}
+
+
+void TickWriter::resetBook(InstrumentId instrument)
+{
+    m_books.at(instrument).clear();
+    m_book_changed[instrument] = true;
+}
+
+
+void TickWriter::addBar(
+        const TimePoint& dt,  
+        double open, 
+        double high, 
+        double low, 
+        double close, 
+        long volume, 
+        double wap, 
+        int count, 
+        InstrumentId instrument)
+{
+    TickRow row;
+    row.table = BAR_TABLE;
+    row.cells[0].i = toNanos(dt);
+    row.cells[1].d = open;
+    row.cells[2].d = high;
+    row.cells[3].d = low;
+    row.cells[4].d = close;
+    row.cells[5].i = volume;
+    row.cells[6].d = wap;
+    row.cells[7].i = count;
+    row.cells[8].i = m_instrument_symbols.at(instrument);
+    submit(row);
+}
+
+
+unsigned TickWriter::internRepeated(std::string& last, unsigned& lastSymbol, const char* s, std::size_t len)
+{
+    // these are short, so last never allocates after the first
+    if(lastSymbol == NO_SYMBOL || last.size() != len || std::memcmp(last.data(), s, len) != 0) {
+        lastSymbol = m_symbols.intern(s, len);
+        last.assign(s, len);
+    }
+    return lastSymbol;
+}
+
+
+void TickWriter::submit(const TickRow& row)
+{
+    if(m_msql_config.asyncWriter) {
+
+        if(m_queue.tryPush(row)) {
+            m_enqueued.fetch_add(1, std::memory_order_relaxed);
+        } else if(m_msql_config.dropWhenFull) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // wait for the writer thread to make room
+            m_stalls.fetch_add(1, std::memory_order_relaxed);
+            while(!m_queue.tryPush(row))
+                std::this_thread::yield();
+            m_enqueued.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // pairs with the fence in writerLoop(): either the writer sees
+        // the row before it waits, or this sees it waiting
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(m_writer_idle.load(std::memory_order_relaxed))
+            wakeWriter();
+        return;
+    }
+
+    buffer(row);
     m_num_data++;
     if( m_auto_flush_every > 0){
         if( m_num_data % m_auto_flush_every == 0)
-            flushToDB(); 
+            writeBundles(); 
+    }
+}
+
+
+void TickWriter::buffer(const TickRow& row)
+{
+    if(!m_pending.tables[row.table].append(row.cells)) {
+        writeBundles();
+        m_pending.tables[row.table].append(row.cells);
     }
 }
 
 
-void TickWriter::flushToDB()
+void TickWriter::writerLoop()
 {
+    const std::chrono::milliseconds interval(m_msql_config.flushIntervalMs);
+    ClockType::time_point last_flush = ClockType::now();
+    TickRow row;
+
+    while(true) {
+
+        // read this before draining so nothing queued before a stop is missed
+        const bool stopping = m_stop;
+
+        // move everything that's queued into the buffer
+        std::size_t drained = 0;
+        while(m_queue.tryPop(row)) {
+            buffer(row);
+            drained++;
+        }
+
+        std::size_t pending = 0;
+        for(const TickColumns& rows : m_pending.tables)
+            pending += rows.size();
+        const bool full = m_msql_config.asyncFlushRows > 0 && pending >= m_msql_config.asyncFlushRows;
+        const bool stale = pending > 0 && ClockType::now() - last_flush >= interval;
+        const bool requested = m_flush_requested.exchange(false);
+        if(pending > 0 && (full || stale || stopping || requested)) {
+            writeBundles();
+            last_flush = ClockType::now();
+            pending = 0;
+        }
+        publishPending();
+
+        if(stopping)
+            break;
+        if(drained > 0)
+            continue;
+
+        // nothing came in: wait for a producer, a flush request, a stop,
+        // or for the pending rows to go stale
+        std::unique_lock<std::mutex> lock(m_wake_mtx);
+        m_writer_idle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(m_queue.empty() && !m_stop && !m_flush_requested) {
+            if(pending > 0)
+                m_wake.wait_until(lock, last_flush + interval);
+            else
+                m_wake.wait(lock);
+        }
+        m_writer_idle.store(false, std::memory_order_relaxed);
+    }
+}
+
+
+void TickWriter::publishPending()
+{
+    m_pending_orders.store(m_pending.tables[BID_ASK_TABLE].size(), std::memory_order_relaxed);
+    m_pending_trades.store(m_pending.tables[TRADE_TABLE].size(), std::memory_order_relaxed);
+}
+
+
+void TickWriter::wakeWriter()
+{
+    std::lock_guard<std::mutex> lock(m_wake_mtx);
+    m_wake.notify_one();
+}
+
+
+void TickWriter::appendCell(std::string& out, ColumnKind kind, const Cell& cell, bool quoted) const
+{
+    switch(kind) {
+    case COL_TIME: {
+        char cstr[TIMESTAMP_LEN];
+        if(quoted) out += '\'';
+        out.append(cstr, formatTimestamp(cstr, cell.i));
+        if(quoted) out += '\'';
+        break;
+    }
+    case COL_DOUBLE:
+        out += std::to_string(cell.d);
+        break;
+    case COL_INT:
+        out += std::to_string(cell.i);
+        break;
+    case COL_SYMBOL:
+        if(quoted) out += '\'';
+        out += m_symbols.name(static_cast<unsigned>(cell.i));
+        if(quoted) out += '\'';
+        break;
+    }
+}
+
+
+void TickWriter::appendValues(std::string& sql, const TickColumns& rows, std::size_t row) const
+{
+    const std::vector<ColumnSpec>& columns = rows.spec().columns;
+    sql += '(';
+    for(unsigned c = 0; c < columns.size(); ++c) {
+        if(c > 0)
+            sql += ", ";
+        appendCell(sql, columns[c].kind, rows.at(row, c), true);
+    }
+    sql += ')';
+}
+
+
+unsigned TickWriter::writeTable(const TickColumns& rows, FlushStats& stats)
+{
+    if(rows.empty())
+        return 0;
+
+    if(m_msql_config.bulkLoadRows > 0 && rows.size() >= m_msql_config.bulkLoadRows)
+        return writeTableBulk(rows, stats);
+
+    if(m_msql_config.flushMode == FLUSH_PREPARED)
+        return writeTablePrepared(rows, stats);
+
+    const unsigned max_rows = m_msql_config.flushMode == FLUSH_PER_ROW 
+                            ? 1 
+                            : m_msql_config.maxRowsPerInsert;
+    // IGNORE, so a row the server rejects (a duplicate, say) doesn't take
+    // the rest of its statement down with it
+    const std::string prefix = insertPrefix(m_msql_config.database, rows.spec(), "INSERT IGNORE");
+
+    std::unique_ptr<sql::Statement> p_stmnt(m_conn->createStatement());
+    std::string sql;
+    std::string values;
+    unsigned rows_in_sql = 0;
+    unsigned rows_written = 0;
+
+    auto execute = [&]() {
+        if(m_printing)
+            std::cout << sql << "\n";        
+        const unsigned taken = std::min<unsigned>(p_stmnt->executeUpdate(sql), rows_in_sql);
+        stats.warnings += countWarnings(p_stmnt->getWarnings(), rows.spec().name);
+        stats.statements++;
+        stats.skippedRows += rows_in_sql - taken;
+        rows_written += taken;
+        rows_in_sql = 0;
+    };
+
+    for(std::size_t row = 0; row < rows.size(); ++row) {
+
+        values.clear();
+        appendValues(values, rows, row);
+
+        // start a new statement if this row wouldn't fit in the current one
+        if( rows_in_sql == max_rows || 
+            (rows_in_sql > 0 && sql.size() + 1 + values.size() > m_msql_config.maxInsertBytes) )
+            execute();
+
+        if(rows_in_sql == 0) {
+            sql = prefix;
+        } else {
+            sql += ',';
+        }
+        sql += values;
+        rows_in_sql++;
+    }
+    execute();
+
+    return rows_written;
+}
+
+
+unsigned TickWriter::writeTableBulk(const TickColumns& rows, FlushStats& stats)
+{
+    std::string path = m_msql_config.bulkLoadDir + "/" + rows.spec().name + "_XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if(fd < 0)
+        throw std::runtime_error("could not create " + path + ": " + std::strerror(errno) + "\n");
+
+    // write the rows out as tab separated lines, a buffer-full at a time
+    const std::vector<ColumnSpec>& columns = rows.spec().columns;
+    const std::size_t chunk_bytes = 1 << 20;
+    std::string tsv;
+    tsv.reserve(chunk_bytes + 4096);
+    bool write_ok = true;
+    auto drain = [&]() {
+        std::size_t done = 0;
+        while(write_ok && done < tsv.size()) {
+            ssize_t n = ::write(fd, tsv.data() + done, tsv.size() - done);
+            if(n < 0 && errno != EINTR)
+                write_ok = false;
+            else if(n > 0)
+                done += n;
+        }
+        tsv.clear();
+    };
+    for(std::size_t row = 0; row < rows.size() && write_ok; ++row) {
+        for(unsigned c = 0; c < columns.size(); ++c) {
+            if(c > 0)
+                tsv += '\t';
+            appendCell(tsv, columns[c].kind, rows.at(row, c), false);
+        }
+        tsv += '\n';
+        if(tsv.size() >= chunk_bytes)
+            drain();
+    }
+    drain();
+    ::close(fd);
+    if(!write_ok) {
+        ::unlink(path.c_str());
+        throw std::runtime_error("could not write " + path + "\n");
+    }
+
+    std::string sql = "LOAD DATA LOCAL INFILE '" + path + "' IGNORE INTO TABLE " 
+                    + m_msql_config.database + "." + rows.spec().name 
+                    + " FIELDS TERMINATED BY '\\t' LINES TERMINATED BY '\\n' (";
+    for(unsigned c = 0; c < columns.size(); ++c) {
+        if(c > 0)
+            sql += ", ";
+        sql += columns[c].name;
+    }
+    sql += ')';
+
+    unsigned taken = 0;
+    try{
+        if(m_printing)
+            std::cout << sql << "\n";
+        std::unique_ptr<sql::Statement> p_stmnt(m_conn->createStatement());
+        taken = std::min<std::size_t>(p_stmnt->executeUpdate(sql), rows.size());
+        stats.warnings += countWarnings(p_stmnt->getWarnings(), rows.spec().name);
+    }catch(...){
+        ::unlink(path.c_str());
+        throw;
+    }
+    ::unlink(path.c_str());
+    stats.statements++;
+    stats.skippedRows += rows.size() - taken;
+
+    return taken;
+}
+
+
+unsigned TickWriter::writeTablePrepared(const TickColumns& rows, FlushStats& stats)
+{
+    // biggest power of two the limits allow (the server caps placeholders at 65535)
+    const unsigned ncols = rows.spec().columns.size();
+    const unsigned max_rows = std::min(m_msql_config.maxRowsPerInsert, 65535 / ncols);
+    unsigned chunk = 1;
+    while(chunk * 2 <= max_rows)
+        chunk *= 2;
+
+    std::size_t row = 0;
+    unsigned taken = 0;
+    while(row < rows.size()) {
+
+        unsigned nrows = chunk;
+        while(nrows > rows.size() - row)
+            nrows /= 2;
+
+        try{
+            taken += executePrepared(rows, row, nrows, stats);
+        }catch(const sql::SQLException& e){
+            if(!preparedStatementsLost(e.getErrorCode()))
+                throw;
+            // preparing again goes through OPT_RECONNECT's reconnection
+            std::cerr << "prepared statements lost (" << e.what() << "), preparing them again\n";
+            m_prepared.clear();
+            m_num_reprepares.fetch_add(1, std::memory_order_relaxed);
+            taken += executePrepared(rows, row, nrows, stats);
+        }
+        stats.statements++;
+        row += nrows;
+    }
+
+    return taken;
+}
+
+
+sql::PreparedStatement& TickWriter::preparedInsert(const TickColumns& rows, unsigned nrows)
+{
+    std::unique_ptr<sql::PreparedStatement>& stmt = m_prepared[std::make_pair(&rows.spec(), nrows)];
+    if(!stmt) {
+        const unsigned ncols = rows.spec().columns.size();
+        std::string placeholders = "(?";
+        for(unsigned c = 1; c < ncols; ++c)
+            placeholders += ",?";
+        placeholders += ')';
+
+        // IGNORE for the same reason as in writeTable()
+        std::string sql = insertPrefix(m_msql_config.database, rows.spec(), "INSERT IGNORE");
+        for(unsigned r = 0; r < nrows; ++r) {
+            if(r > 0)
+                sql += ',';
+            sql += placeholders;
+        }
+        if(m_printing)
+            std::cout << "preparing " << nrows << " row insert into " << rows.spec().name << "\n";
+        stmt.reset(m_conn->prepareStatement(sql));
+    }
+    return *stmt;
+}
+
+
+unsigned TickWriter::executePrepared(const TickColumns& rows, std::size_t first, unsigned nrows, FlushStats& stats)
+{
+    sql::PreparedStatement& stmt = preparedInsert(rows, nrows);
+    const std::vector<ColumnSpec>& columns = rows.spec().columns;
+    const unsigned ncols = columns.size();
+
+    // bind a column at a time; parameter (r, c) is r * ncols + c + 1
+    char stamp[TIMESTAMP_LEN];
+    for(unsigned c = 0; c < ncols; ++c) {
+        const Cell* cells = rows.column(c) + first;
+        unsigned idx = c + 1;
+        for(unsigned r = 0; r < nrows; ++r, idx += ncols) {
+            switch(columns[c].kind) {
+            case COL_TIME:
+                stmt.setDateTime(idx, sql::SQLString(stamp, formatTimestamp(stamp, cells[r].i)));
+                break;
+            case COL_DOUBLE:
+                stmt.setDouble(idx, cells[r].d);
+                break;
+            case COL_INT:
+                stmt.setInt64(idx, cells[r].i);
+                break;
+            case COL_SYMBOL:
+                stmt.setString(idx, m_symbols.name(static_cast<unsigned>(cells[r].i)));
+                break;
+            }
+        }
+    }
+    const unsigned taken = std::min<unsigned>(stmt.executeUpdate(), nrows);
+    stats.warnings += countWarnings(stmt.getWarnings(), rows.spec().name);
+    stats.skippedRows += nrows - taken;
+    return taken;
+}
+
+
+FlushStats TickWriter::flushToDB()
+{
+    if(m_msql_config.asyncWriter) {
+        m_flush_requested = true;
+        wakeWriter();
+        return lastFlushStats();
+    }
+    return writeBundles();
+}
+
+
+FlushStats TickWriter::writeBundles()
+{
+    const ClockType::time_point start = ClockType::now();
+
     // print to see
     if(m_printing)
         std::cout << "attempting to write data for symbols\n";
 
-    // step 1: write order information
-    try{
-        for(const auto& tick : m_order_bundle) {
-        
-            // make the symbol uppercase just in case (pun intended)
-            std::string sql = "INSERT INTO " 
-                            + m_msql_config.database + "." + m_msql_config.orderTable  
-                            + " VALUES ('"
-                            + hft::toString(tick.tp) + "', "
-                            + std::to_string(tick.bidPrice) + ", "
-                            + std::to_string(tick.askPrice) + ", "
-                            + std::to_string(tick.bidSize) + ", "
-                            + std::to_string(tick.askSize) + ", '"
-                            + tick.instrument + "');";
-            if(m_printing)
-                std::cout << sql << "\n";        
-            std::unique_ptr<sql::Statement> p_stmnt(m_conn->createStatement());
-            p_stmnt->execute(sql);
+    FlushStats stats {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    // the replay thread got through to the database, so stop spooling and
+    // hand it everything spooled so far
+    if(m_spooling && m_db_back.exchange(false)) {
+        try{
+            m_spool->seal();
+            m_prepared.clear();
+            if(!m_conn->isValid()) {
+                m_reconnects.fetch_add(1, std::memory_order_relaxed);
+                m_conn->reconnect();
+            }
+            m_spooling = false;
+            std::cerr << "database is back, no longer spooling\n";
+        }catch(const std::exception& e){
+            m_db_errors.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "flushToDB problem: " << e.what() << "\n"; 
         }
-    
-    }catch(const std::exception& e){
-        std::cerr << "flushToDB problem: " << e.what() << "\n"; 
-    }catch(...){
-        std::cerr << "unspecified flushToDB problem\n";
     }
-    m_order_bundle.clear();  
 
+    std::vector<unsigned> written(m_tables.size(), 0);
+    for(unsigned t = 0; t < m_tables.size(); ++t) {
+        bool ok = false;
+        if(!m_spooling) {
+            try{
+                written[t] = writeTable(m_pending.tables[t], stats);
+                ok = true;
+                if(t <= DEPTH_TABLE && m_trace.load(std::memory_order_relaxed))
+                    traceCommit(m_pending.tables[t], toNanos(ClockType::now()));
+            }catch(const std::exception& e){
+                m_db_errors.fetch_add(1, std::memory_order_relaxed);
+                std::cerr << "flushToDB problem: " << e.what() << "\n"; 
+            }catch(...){
+                m_db_errors.fetch_add(1, std::memory_order_relaxed);
+                std::cerr << "unspecified flushToDB problem\n";
+            }
+        }
+        if(!ok && m_spool) {
+            // rows a failed statement did get in are skipped on replay
+            try{
+                stats.spooledRows += m_spool->append(t, m_pending.tables[t], m_symbols);
+                if(!m_spooling)
+                    std::cerr << "database is down, spooling to " << m_msql_config.spoolDir << "\n";
+                m_spooling = true;
+            }catch(const std::exception& e){
+                std::cerr << "spool problem: " << e.what() << "\n"; 
+            }
+        }
+        m_pending.tables[t].clear();
+    }
+    stats.orderRows = written[BID_ASK_TABLE];
+    stats.tradeRows = written[TRADE_TABLE];
+    stats.midPointRows = written[MID_POINT_TABLE];
+    stats.depthRows = written[DEPTH_TABLE];
+    stats.barRows = written[BAR_TABLE];
+    stats.snapshotRows = written[DEPTH_SNAPSHOT_TABLE];
+    for(unsigned t = NUM_TABLES; t < m_tables.size(); ++t)
+        stats.tradeBarRows += written[t];
 
-    // step 2: write trade information
-    try{
-        for(const auto& trade : m_trade_bundle) {
-        
-            // make the symbol uppercase just in case (pun intended)
-            std::string sql = "INSERT INTO " 
-                            + m_msql_config.database + "." + m_msql_config.tradeTable  
-                            + " VALUES ('"
-                            + hft::toString(trade.tp) + "', "
-                            + std::to_string(trade.price) + ", "
-                            + std::to_string(trade.size) + ", '" 
-                            + trade.exchange+ "', '"
-                            + trade.instrument + "');";
-
-            if(m_printing)
-                std::cout << sql << "\n";        
-            std::unique_ptr<sql::Statement> p_stmnt(m_conn->createStatement());
-            p_stmnt->execute(sql);
+    // one fdatasync per flush
+    if(stats.spooledRows > 0) {
+        try{
+            m_spool->sync();
+        }catch(const std::exception& e){
+            std::cerr << "spool problem: " << e.what() << "\n"; 
         }
-    
-    }catch(const std::exception& e){
-        std::cerr << "flushToDB problem: " << e.what() << "\n"; 
-    }catch(...){
-        std::cerr << "unspecified flushToDB problem\n";
+        m_spooled.fetch_add(stats.spooledRows, std::memory_order_relaxed);
+    }
+    m_skipped.fetch_add(stats.skippedRows, std::memory_order_relaxed);
+    m_db_warnings.fetch_add(stats.warnings, std::memory_order_relaxed);
+
+    if(m_printing)
+        std::cout << "wrote " << stats.orderRows << " orders, " 
+                  << stats.tradeRows << " trades, " 
+                  << stats.midPointRows << " mid points, " 
+                  << stats.depthRows << " depth updates, " 
+                  << stats.snapshotRows << " book levels, " 
+                  << stats.barRows << " bars and " 
+                  << stats.tradeBarRows << " bars built from trades in " 
+                  << stats.statements << " statements (" 
+                  << stats.skippedRows << " rows skipped, " 
+                  << stats.warnings << " warnings)\n";
+
+    {
+        std::lock_guard<std::mutex> lock(m_last_flush_mtx);
+        m_last_flush = stats;
     }
-    m_trade_bundle.clear();   
+    m_flush_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(ClockType::now() - start).count());
+    m_bundle_rows.record(stats.orderRows + stats.tradeRows + stats.midPointRows + stats.depthRows
+                         + stats.barRows + stats.snapshotRows + stats.tradeBarRows + stats.spooledRows
+                         + stats.skippedRows);
+    m_num_flushes.fetch_add(1, std::memory_order_relaxed);
+    return stats;
+}
+
+
+void TickWriter::traceCommit(const TickColumns& rows, std::int64_t committed)
+{
+    LatencyTrace* trace = m_trace.load(std::memory_order_relaxed);
+    // dt comes first and the instrument's symbol last
+    const unsigned instrument_col = rows.spec().columns.size() - 1;
+    const Cell* dts = rows.column(0);
+    const Cell* symbols = rows.column(instrument_col);
+    for(std::size_t r = 0; r < rows.size(); ++r)
+        trace->record(STAGE_COMMIT, m_symbol_instruments[symbols[r].i], dts[r].i, committed);
+}
+
+
+void TickWriter::replayLoop()
+{
+    std::unique_ptr<sql::Connection> conn;
+
+    while(!m_stop) {
 
+        try{
+            // while the writer is spooling, probe until the database answers
+            if(m_spooling) {
+                if(conn && !conn->isValid())
+                    conn.reset();
+                if(!conn)
+                    conn.reset(connect(false));
+                m_db_back = true;
+            }
 
+            for(const std::string& path : m_spool->sealedSegments()) {
+                if(m_stop)
+                    break;
+                if(!conn)
+                    conn.reset(connect(false));
+                std::size_t sent = 0;
+                const std::size_t rows = replaySegment(*conn, path, sent);
+                ::unlink(path.c_str());
+                m_replayed.fetch_add(rows, std::memory_order_relaxed);
+                if(m_printing)
+                    std::cout << "replayed " << rows << " of " << sent << " spooled rows from " << path 
+                              << " (the rest were in already)\n";
+            }
+        }catch(const std::exception& e){
+            m_db_errors.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "spool replay problem: " << e.what() << "\n";
+            conn.reset();
+        }
+
+        for(unsigned waited = 0; waited < m_msql_config.spoolRetryMs && !m_stop; waited += 10)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
 }
 
+
+std::size_t TickWriter::replaySegment(sql::Connection& conn, const std::string& path, std::size_t& sent)
+{
+    // one multi-row INSERT IGNORE in the making per table
+    const unsigned ntables = m_tables.size();
+    std::vector<std::string> prefixes(ntables);
+    std::vector<std::string> sqls(ntables);
+    std::vector<unsigned> rows_in_sql(ntables, 0);
+    for(unsigned t = 0; t < ntables; ++t)
+        prefixes[t] = insertPrefix(m_msql_config.database, m_tables[t], "INSERT IGNORE");
+
+    std::unique_ptr<sql::Statement> p_stmnt(conn.createStatement());
+    std::size_t taken = 0;
+    auto execute = [&](unsigned t) {
+        if(rows_in_sql[t] == 0)
+            return;
+        taken += std::min<unsigned>(p_stmnt->executeUpdate(sqls[t]), rows_in_sql[t]);
+        m_db_warnings.fetch_add(countWarnings(p_stmnt->getWarnings(), m_tables[t].name), std::memory_order_relaxed);
+        rows_in_sql[t] = 0;
+    };
+
+    SpoolReader reader(path);
+    SpoolRecord rec;
+    std::string values;
+    std::size_t rows = 0;
+    while(reader.next(rec)) {
+
+        // a run with more barIntervals may have spooled to tables this one lacks
+        if(rec.table >= ntables)
+            continue;
+        const unsigned t = rec.table;
+        const std::vector<ColumnSpec>& columns = m_tables[t].columns;
+
+        values = "(";
+        for(unsigned c = 0; c < columns.size(); ++c) {
+            if(c > 0)
+                values += ", ";
+            if(columns[c].kind == COL_SYMBOL) {
+                rec.text[c][SPOOL_SYMBOL_LEN - 1] = '\0';
+                values += '\'';
+                values += rec.text[c];
+                values += '\'';
+            } else {
+                appendCell(values, columns[c].kind, rec.cells[c], true);
+            }
+        }
+        values += ')';
+
+        if( rows_in_sql[t] == m_msql_config.maxRowsPerInsert || 
+            (rows_in_sql[t] > 0 && sqls[t].size() + 1 + values.size() > m_msql_config.maxInsertBytes) )
+            execute(t);
+
+        if(rows_in_sql[t] == 0) {
+            sqls[t] = prefixes[t];
+        } else {
+            sqls[t] += ',';
+        }
+        sqls[t] += values;
+        rows_in_sql[t]++;
+        rows++;
+    }
+    for(unsigned t = 0; t < ntables; ++t)
+        execute(t);
+
+    sent = rows;
+    return taken;
+}
+
+
+FlushStats TickWriter::lastFlushStats() const
+{
+    std::lock_guard<std::mutex> lock(m_last_flush_mtx);
+    return m_last_flush;
+}
+
+
+WriterStats TickWriter::stats() const
+{
+    WriterStats ws;
+    ws.queueDepth    = m_msql_config.asyncWriter ? m_queue.size() : 0;
+    ws.queueCapacity = m_msql_config.asyncWriter ? m_queue.capacity() : 0;
+    ws.enqueued      = m_enqueued.load(std::memory_order_relaxed);
+    ws.dropped       = m_dropped.load(std::memory_order_relaxed);
+    ws.stalls        = m_stalls.load(std::memory_order_relaxed);
+    ws.flushes       = m_num_flushes.load(std::memory_order_relaxed);
+    ws.flushP50Nanos = m_flush_latency.percentile(0.5);
+    ws.flushP99Nanos = m_flush_latency.percentile(0.99);
+    ws.flushMaxNanos = m_flush_latency.max();
+    ws.reprepares    = m_num_reprepares.load(std::memory_order_relaxed);
+    ws.dbErrors      = m_db_errors.load(std::memory_order_relaxed);
+    ws.reconnects    = m_reconnects.load(std::memory_order_relaxed);
+    ws.spooledRows   = m_spooled.load(std::memory_order_relaxed);
+    ws.replayedRows  = m_replayed.load(std::memory_order_relaxed);
+    ws.skippedRows   = m_skipped.load(std::memory_order_relaxed);
+    ws.dbWarnings    = m_db_warnings.load(std::memory_order_relaxed);
+    ws.unknownSymbols = m_symbols.overflows();
+    ws.spooling      = m_spooling;
+    return ws;
+}
+
+
+const LatencyHistogram& TickWriter::flushLatency() const
+{
+    return m_flush_latency;
+}
+
+
+const LatencyHistogram& TickWriter::bundleRows() const
+{
+    return m_bundle_rows;
+}
+
+
+void TickWriter::traceCommits(LatencyTrace* trace)
+{
+    m_trace = trace;
+}
+
+
 unsigned TickWriter::sizeOrders() const
 {
-    return m_order_bundle.size();
+    // the buffer belongs to the writer thread, if there is one
+    if(m_msql_config.asyncWriter)
+        return m_pending_orders.load(std::memory_order_relaxed);
+    return m_pending.tables[BID_ASK_TABLE].size();
 }
 
 
 unsigned TickWriter::sizeTrades() const
 {
-    return m_trade_bundle.size();
+    if(m_msql_config.asyncWriter)
+        return m_pending_trades.load(std::memory_order_relaxed);
+    return m_pending.tables[TRADE_TABLE].size();
 }
 
 } // namespace hft
@@ -4,9 +4,25 @@
 #include <string>
 #include <map>
 #include <cppconn/driver.h> 
+#include <cppconn/prepared_statement.h>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
 
 #include "config.h"
+#include "spsc_ring.h"
+#include "latency_histogram.h"
+#include "latency_trace.h"
+#include "order_book.h"
+#include "bar_builder.h"
+#include "symbol_table.h"
+#include "tick_columns.h"
+#include "tick_spool.h"
+#include "timestamp.h"
 
 
 //* TODOs (maybe put a separate class and in a separate header)
@@ -31,6 +47,28 @@ using TimePoint = std::chrono::time_point<ClockType>;
 inline std::string toString(const TimePoint& time);
 
 
+/**
+ * @enum FlushMode
+ * @brief how flushToDB() turns a bundle into INSERT statements
+ */
+enum FlushMode {
+    FLUSH_PER_ROW,   // one INSERT (and one server round trip) per tick
+    FLUSH_MULTI_ROW, // INSERT ... VALUES (...),(...),... in batches
+    FLUSH_PREPARED   // multi-row INSERTs prepared once and rebound every batch
+};
+
+
+/**
+ * @enum DepthMode
+ * @brief what's written out of market depth
+ */
+enum DepthMode {
+    DEPTH_DELTAS,    // every update, as it arrives
+    DEPTH_SNAPSHOTS, // the whole book, at most every depthSnapshotMs
+    DEPTH_BOTH
+};
+
+
 /**
  * @struct UserPassCredentials
  * @brief stores a username and password
@@ -54,9 +92,23 @@ struct MySqlConfig {
     /* the table for orders */
     std::string orderTable;
 
-    /* the table for orders */
+    /* the table for trades */
     std::string tradeTable;
 
+    /* the tables for mid points, market depth and 5 second bars */
+    std::string midPointTable;
+    std::string depthTable;
+    std::string barTable;
+
+    /* what's written out of market depth, and how often a book may be snapshot (milliseconds) */
+    DepthMode depthMode;
+    unsigned depthSnapshotMs;
+    std::string depthSnapshotTable;
+
+    /* lengths (seconds) of the bars built from trades, each written to barTablePrefix + "1s", "1m", ... */
+    std::vector<unsigned> barIntervals;
+    std::string barTablePrefix;
+
     /* the host */
     std::string host;
 
@@ -66,6 +118,49 @@ struct MySqlConfig {
     /* the username and password */
     UserPassCredentials credentials;
 
+    /* how bundles are written out */
+    FlushMode flushMode;
+
+    /* the most rows a single multi-row INSERT may carry */
+    unsigned maxRowsPerInsert;
+
+    /* the most bytes a single multi-row INSERT may take up (keep below max_allowed_packet) */
+    std::size_t maxInsertBytes;
+
+    /* hand ticks to a background writer thread instead of flushing on the caller's thread */
+    bool asyncWriter;
+
+    /* how many ticks the writer thread's queue can hold */
+    std::size_t queueCapacity;
+
+    /* when the queue is full, drop the tick (true) or wait for room (false) */
+    bool dropWhenFull;
+
+    /* the writer thread flushes at least this often (milliseconds) when it has ticks */
+    unsigned flushIntervalMs;
+
+    /* the writer thread also flushes once this many rows are pending (0 means only
+     * flushIntervalMs and a full buffer do); autoFlushEvery is for synchronous mode */
+    std::size_t asyncFlushRows;
+
+    /* how many rows of each table a buffer holds before it must be flushed */
+    std::size_t bufferCapacity;
+
+    /* tables with at least this many pending rows go in through LOAD DATA LOCAL INFILE (0 means never) */
+    std::size_t bulkLoadRows;
+
+    /* where the bulk load's temporary files go */
+    std::string bulkLoadDir;
+
+    /* rows that can't be written go to a spool in this directory (empty means drop them) */
+    std::string spoolDir;
+
+    /* size at which a spool segment is handed over for replay */
+    std::size_t spoolSegmentBytes;
+
+    /* how often the replay thread checks on the database while it's down (milliseconds) */
+    unsigned spoolRetryMs;
+
     /**
      * @brief reads the config from the specified file, with the following format
      *
@@ -79,6 +174,31 @@ struct MySqlConfig {
      * password=Password
      * -------------------
      *
+     * the following keys are optional
+     *
+     * -------------------
+     * midPointTable=mid_point_data
+     * depthTable=depth_data
+     * barTable=bar_data
+     * depthMode=deltas (or snapshots, or both)
+     * depthSnapshotMs=1000
+     * depthSnapshotTable=depth_snapshot_data
+     * barIntervals= (seconds, comma separated, e.g. 1,60)
+     * barTablePrefix=trade_bars_
+     * flushMode=multirow (or perrow, or prepared)
+     * maxRowsPerInsert=1000
+     * maxInsertBytes=1048576
+     * asyncWriter=0 (or 1)
+     * queueCapacity=65536
+     * queueFullPolicy=block (or drop)
+     * flushIntervalMs=250
+     * bufferCapacity=16384
+     * bulkLoadRows=0
+     * bulkLoadDir=/tmp
+     * spoolDir=
+     * spoolSegmentBytes=67108864
+     * spoolRetryMs=1000
+     * -------------------
      *
      * @param path the file path
      * @return parsed config
@@ -90,29 +210,71 @@ struct MySqlConfig {
 
 
 /**
- * @struct BidAsk
- * @brief top of order book at one moment
+ * @enum TableId
+ * @brief the tables TickWriter writes to
+ */
+enum TableId : unsigned char {
+    BID_ASK_TABLE,        // top of order book at one moment
+    TRADE_TABLE,          // an executed trade
+    MID_POINT_TABLE,      // mid point of the top of the book
+    DEPTH_TABLE,          // one change to a level of the order book
+    BAR_TABLE,            // a 5 second bar
+    DEPTH_SNAPSHOT_TABLE, // one level of an order book at one moment
+    NUM_TABLES            // the tables of bars built from trades follow, one per barIntervals entry
+};
+
+
+/**
+ * @struct TickBuffer
+ * @brief pending rows for every table
+ */
+struct TickBuffer {
+    std::vector<TickColumns> tables; // indexed by TableId
+};
+
+
+/**
+ * @struct FlushStats
+ * @brief what a single call to flushToDB() wrote out
  */
-struct BidAsk {
-    TimePoint tp;
-    double bidPrice;
-    double askPrice;
-    int bidSize;
-    int askSize;
-    std::string instrument;
+struct FlushStats {
+    unsigned orderRows;
+    unsigned tradeRows;
+    unsigned statements;
+    unsigned spooledRows; // rows that went to the spool instead
+    unsigned midPointRows;
+    unsigned depthRows;
+    unsigned barRows;
+    unsigned snapshotRows;
+    unsigned tradeBarRows; // all intervals together
+    unsigned skippedRows;  // rows sent that the server ignored, e.g. duplicates
+    unsigned warnings;     // other warnings, e.g. values truncated to fit their column
 };
 
 
 /**
- * @struct Trade
- * @brief an executed trade 
+ * @struct WriterStats
+ * @brief a snapshot of the asynchronous writer's counters
  */
-struct Trade {
-    TimePoint tp;
-    double price;
-    int size;
-    std::string exchange;
-    std::string instrument;
+struct WriterStats {
+    std::size_t queueDepth;
+    std::size_t queueCapacity;
+    std::uint64_t enqueued;
+    std::uint64_t dropped;   // ticks thrown away because the queue was full
+    std::uint64_t stalls;    // times the caller had to wait for room in the queue
+    std::uint64_t flushes;
+    std::uint64_t flushP50Nanos;
+    std::uint64_t flushP99Nanos;
+    std::uint64_t flushMaxNanos;
+    std::uint64_t reprepares; // times the prepared statements were lost and made again
+    std::uint64_t dbErrors;   // statements, reconnects and spool replays that failed
+    std::uint64_t reconnects; // times the writer's connection was made again
+    std::uint64_t spooledRows;
+    std::uint64_t replayedRows;
+    std::uint64_t skippedRows; // rows the server ignored (FlushStats::skippedRows)
+    std::uint64_t dbWarnings;  // FlushStats::warnings, and the spool replay's
+    std::uint64_t unknownSymbols; // exchanges and market makers written as "?" because the symbol table was full
+    bool spooling;            // the database is considered down
 };
 
 
@@ -136,7 +298,8 @@ public:
      * @param sym_table_file (same as the one provides to trade client)
      * @param printing
      * @param reconnect
-     * @param autoFlushEvery 0 means never
+     * @param autoFlushEvery 0 means never (synchronous mode only, the
+     * writer thread goes by asyncFlushRows instead)
      */
     explicit TickWriter(const std::string& mysql_cnfg_file, 
                         const std::string& sym_table_file, 
@@ -152,47 +315,316 @@ public:
 
 
     /**
-     * @brief adds bid/ask to its bundle 
+     * @brief adds bid/ask to its bundle (see instrument_from_uid()
+     * for the instrument)
      */
     void addBidAsk(const TimePoint& dt, 
                    double bidPrice, 
                    double askPrice,
                    int bidSize,
                    int askSize,    
-                   const std::string& instrument); 
+                   InstrumentId instrument); 
 
 
     /**
-     * @brief adds trade to its bundle 
+     * @brief adds trade to its bundle (see instrument_from_uid()
+     * for the instrument)
      */
     void addTrade(const TimePoint& dt, 
                    double price, 
                    int size,
                    const std::string& exchange,
-                   const std::string& instrument); 
+                   InstrumentId instrument); 
+
+
+    /**
+     * @brief same, with the exchange as len chars that needn't
+     * outlive the call (e.g. still in the message they came in)
+     */
+    void addTrade(const TimePoint& dt, 
+                   double price, 
+                   int size,
+                   const char* exchange,
+                   std::size_t len,
+                   InstrumentId instrument); 
+
+
+    /**
+     * @brief adds a tick-by-tick mid point to its bundle
+     */
+    void addMidPoint(const TimePoint& dt, 
+                     double midPoint,
+                     InstrumentId instrument); 
+
+
+    /**
+     * @brief applies a change to one level of the instrument's order
+     * book, and adds it to its bundle or snapshots the book, depending
+     * on depthMode (the market maker is empty for updateMktDepth())
+     */
+    void addDepth(const TimePoint& dt, 
+                  int position,
+                  int operation,
+                  int side,
+                  double price,
+                  int size,
+                  const char* marketMaker,
+                  std::size_t len,
+                  InstrumentId instrument); 
+
+
+    /**
+     * @brief snapshots the books that changed since their last
+     * snapshot, if that was at least depthSnapshotMs ago. addDepth()
+     * does this for its own book; call this every now and then so a
+     * book that stopped changing gets its last state written, too.
+     */
+    void snapshotBooks(const TimePoint& now);
+
+
+    /**
+     * @brief an instrument's book as market depth updates left it
+     * (only for the thread that calls addDepth())
+     */
+    const OrderBook& book(InstrumentId instrument) const;
+
+
+    /**
+     * @brief empties an instrument's book, e.g. when IB says its
+     * depth was reset
+     */
+    void resetBook(InstrumentId instrument);
+
+
+    /**
+     * @brief finishes the bars built from trades whose interval is
+     * over. Trades and quotes do this for their own instrument; call
+     * this every now and then so bars still get written when an
+     * instrument goes quiet.
+     */
+    void closeBars(const TimePoint& now);
+
+
+    /**
+     * @brief adds a bar to its bundle; dt is when the bar starts
+     */
+    void addBar(const TimePoint& dt, 
+                double open,
+                double high,
+                double low,
+                double close,
+                long volume,
+                double wap,
+                int count,
+                InstrumentId instrument); 
 
 
     /**
      * @brief writes all the elements in the list to a database
+     * In asynchronous mode this only asks the writer thread to
+     * flush soon, and returns what its previous flush wrote.
+     * @return how many rows and statements were written
+     */
+    FlushStats flushToDB();
+
+
+    /**
+     * @brief what the most recent flushToDB() wrote out
+     */
+    FlushStats lastFlushStats() const;
+
+
+    /**
+     * @brief counters for the asynchronous writer (queue fields are
+     * zero in synchronous mode) and the flush latency distribution
+     */
+    WriterStats stats() const;
+
+
+    /**
+     * @brief every flush's duration, in nanoseconds
+     */
+    const LatencyHistogram& flushLatency() const;
+
+
+    /**
+     * @brief every flush's size, in rows (written or spooled)
      */
-    void flushToDB();
+    const LatencyHistogram& bundleRows() const;
+
+
+    /**
+     * @brief records, for every tick a flush commits, how long after
+     * its dt that was (STAGE_COMMIT). Bars and book snapshots aren't
+     * stamped on arrival, so they are left out. Null stops it.
+     */
+    void traceCommits(LatencyTrace* trace);
 
 
     /**
      * @brief returns the number of orders that have not
-     * yet been written to a database
+     * yet been written to a database. In asynchronous mode
+     * that's as of the writer thread's last pass, and orders
+     * still in its queue aren't counted.
      */
     unsigned sizeOrders() const;
 
 
     /**
      * @brief returns the number of trades that have not
-     * yet been written to a database
+     * yet been written to a database (same caveat)
      */
     unsigned sizeTrades() const;
  
 private:
- 
+
+
+    /**
+     * @brief writes the pending rows out and clears them
+     */
+    FlushStats writeBundles();
+
+
+    /**
+     * @brief STAGE_COMMIT of each tick of a table writeBundles()
+     * just committed
+     */
+    void traceCommit(const TickColumns& rows, std::int64_t committed);
+
+
+    /**
+     * @brief the symbol id of a string that usually repeats the
+     * previous one (exchanges, market makers), remembered in last
+     */
+    unsigned internRepeated(std::string& last, unsigned& lastSymbol, const char* s, std::size_t len);
+
+
+    /**
+     * @brief feeds a trade to every bar builder
+     */
+    void buildBars(std::int64_t nanos, double price, int size, InstrumentId instrument);
+
+
+    /**
+     * @brief adds a finished bar to the bundle
+     */
+    void submitBar(unsigned table, InstrumentId instrument, const TradeBar& bar);
+
+
+    /**
+     * @brief adds every level of a book to the bundle
+     */
+    void snapshotBook(std::int64_t nanos, InstrumentId instrument);
+
+
+    /**
+     * @brief synchronous mode: buffers the row and flushes if it's time
+     * asynchronous mode: queues the row for the writer thread
+     */
+    void submit(const TickRow& row);
+
+
+    /**
+     * @brief appends to the pending rows, flushing first if that table is full
+     */
+    void buffer(const TickRow& row);
+
+
+    /**
+     * @brief body of the writer thread
+     */
+    void writerLoop();
+
+
+    /**
+     * @brief wakes the writer thread if it's waiting for work
+     */
+    void wakeWriter();
+
+
+    /**
+     * @brief writer thread: publishes the pending row counts
+     * sizeOrders() and sizeTrades() report
+     */
+    void publishPending();
+
+
+    /**
+     * @brief opens a new connection to the configured database
+     */
+    sql::Connection* connect(bool reconnect) const;
+
+
+    /**
+     * @brief body of the replay thread: waits for the database to
+     * come back and feeds it the sealed spool segments on a
+     * connection of its own
+     */
+    void replayLoop();
+
+
+    /**
+     * @brief INSERT IGNOREs one segment, so rows that made it in
+     * before (the primary keys cover every column) are skipped
+     * @param sent set to the number of rows read from the segment
+     * @return the number of rows the server took
+     */
+    std::size_t replaySegment(sql::Connection& conn, const std::string& path, std::size_t& sent);
+
+    
+    /**
+     * @brief writes one table's rows, packing up to maxRowsPerInsert
+     * rows into each statement (one in per-row mode). Every path uses
+     * INSERT IGNORE (or LOAD DATA ... IGNORE), so rows the server
+     * rejects are skipped rather than failing their whole statement;
+     * they go into stats.skippedRows, not the rows written.
+     * @return the number of rows written
+     */
+    unsigned writeTable(const TickColumns& rows, FlushStats& stats);
+
+
+    /**
+     * @brief the "('...', ...)" part of an INSERT for one row
+     */
+    void appendValues(std::string& sql, const TickColumns& rows, std::size_t row) const;
+
+
+    /**
+     * @brief one value as SQL text (quoted for an INSERT, bare for a TSV file)
+     */
+    void appendCell(std::string& out, ColumnKind kind, const Cell& cell, bool quoted) const;
+
+
+    /**
+     * @brief bulk version of writeTable(): dumps the rows to a
+     * temporary TSV file and has the server LOAD DATA LOCAL INFILE it
+     * @return the number of rows written
+     */
+    unsigned writeTableBulk(const TickColumns& rows, FlushStats& stats);
+
+
+    /**
+     * @brief prepared mode version of writeTable(). Rows go out in
+     * power-of-two chunks so each table needs only a handful of
+     * statements, and a chunk that fails because the connection
+     * dropped is retried once on freshly prepared statements.
+     * @return the number of rows written
+     */
+    unsigned writeTablePrepared(const TickColumns& rows, FlushStats& stats);
+
+
+    /**
+     * @brief the cached INSERT for nrows rows of a table, preparing it
+     * on first use
+     */
+    sql::PreparedStatement& preparedInsert(const TickColumns& rows, unsigned nrows);
+
+
+    /**
+     * @brief binds rows [first, first + nrows) and executes
+     * @return the number of rows the server took
+     */
+    unsigned executePrepared(const TickColumns& rows, std::size_t first, unsigned nrows, FlushStats& stats);
    
     /* the database configuration */
     MySqlConfig m_msql_config;
@@ -206,17 +638,117 @@ private:
     /* whether or not to print when you add rows */
     bool m_printing;
 
-    /* an arbitrarily-long collection of order info */ 
-    std::list<BidAsk> m_order_bundle; 
+    /* the tables and their columns (indexed by TableId, then the trade bar tables) */
+    std::vector<TableSpec> m_tables;
+
+    /* instruments first (in the same order as the symbol file), then exchanges */
+    SymbolTable m_symbols;
+
+    /* symbol id of each InstrumentId */
+    std::vector<unsigned> m_instrument_symbols;
 
-    /* an arbitrarily-long collection of trade info */ 
-    std::list<Trade> m_trade_bundle; 
+    /* InstrumentId of each instrument symbol id; an instrument listed twice
+     * in the symbol file shares its symbol, which maps to the first one */
+    std::vector<InstrumentId> m_symbol_instruments;
+
+    /* the last exchange seen (trades mostly come from the same few) */
+    std::string m_last_exchange;
+    unsigned m_last_exchange_symbol;
+
+    /* the same for depth updates' market makers */
+    std::string m_last_market_maker;
+    unsigned m_last_market_maker_symbol;
+
+    /* the order book of each InstrumentId */
+    std::vector<OrderBook> m_books;
+
+    /* when each book was last snapshot (nanoseconds), and whether it changed since */
+    std::vector<std::int64_t> m_last_snapshot;
+    std::vector<bool> m_book_changed;
+
+    /* one per barIntervals entry; builder b writes to table NUM_TABLES + b */
+    std::vector<BarBuilder> m_bar_builders;
+
+    /* rows waiting to be written out */
+    TickBuffer m_pending;
+
+    /* prepared INSERTs, keyed by table and rows per statement
+     * (server-side, so they die with the connection) */
+    std::map<std::pair<const TableSpec*, unsigned>, std::unique_ptr<sql::PreparedStatement>> m_prepared;
+
+    /* number of times m_prepared had to be thrown away */
+    std::atomic<std::uint64_t> m_num_reprepares;
+
+    /* rows that couldn't be written (null if spoolDir is empty) */
+    std::unique_ptr<TickSpool> m_spool;
+
+    /* flushes go straight to the spool while this is set */
+    std::atomic<bool> m_spooling;
+
+    /* set by the replay thread once it can reach the database again */
+    std::atomic<bool> m_db_back;
+
+    /* spool counters */
+    std::atomic<std::uint64_t> m_spooled;
+    std::atomic<std::uint64_t> m_replayed;
 
     /* running total of the number of data points seen  */
     unsigned m_num_data;
 
     /* how often do you want to flush data to db? */
     unsigned m_auto_flush_every;
+
+    /* what the most recent flush wrote */
+    FlushStats m_last_flush;
+    mutable std::mutex m_last_flush_mtx;
+
+    /* every flush's duration */
+    LatencyHistogram m_flush_latency;
+
+    /* every flush's size */
+    LatencyHistogram m_bundle_rows;
+
+    /* database problems, from the writer and the replay thread */
+    std::atomic<std::uint64_t> m_db_errors;
+    std::atomic<std::uint64_t> m_db_warnings;
+    std::atomic<std::uint64_t> m_skipped;
+    std::atomic<std::uint64_t> m_reconnects;
+
+    /* where committed ticks' latency goes, if anywhere */
+    std::atomic<LatencyTrace*> m_trace;
+
+    /* number of flushes so far */
+    std::atomic<std::uint64_t> m_num_flushes;
+
+    /* rows waiting for the writer thread (only used in async mode) */
+    SpscRing<TickRow> m_queue;
+
+    /* producer-side queue counters */
+    std::atomic<std::uint64_t> m_enqueued;
+    std::atomic<std::uint64_t> m_dropped;
+    std::atomic<std::uint64_t> m_stalls;
+
+    /* set to ask the writer thread to flush as soon as it can */
+    std::atomic<bool> m_flush_requested;
+
+    /* the writer thread's pending orders and trades, for other threads to read */
+    std::atomic<unsigned> m_pending_orders;
+    std::atomic<unsigned> m_pending_trades;
+
+    /* set to stop the writer thread */
+    std::atomic<bool> m_stop;
+
+    /* the writer thread waits on m_wake while it has nothing to do, with
+     * m_writer_idle set so producers only notify when it's asleep */
+    std::mutex m_wake_mtx;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_writer_idle;
+
+    /* the writer thread (only started in async mode) */
+    std::thread m_writer;
+
+    /* the replay thread (only started with a spool) */
+    std::thread m_replayer;
 };
 
 } // namespace hft
@@ -0,0 +1,49 @@
+#include "timestamp.h"
+
+#include <ctime> // localtime_r, strftime
+#include <cstring> // memcpy
+
+
+namespace hft{
+
+
+/* the formatted second most recently seen by this thread */
+struct SecondCache {
+    std::int64_t second;
+    char prefix[20]; // "YYYY-MM-DD HH:MM:SS" plus strftime's NUL
+};
+
+
+static thread_local SecondCache cache = {INT64_MIN, {0}};
+
+
+std::size_t formatTimestamp(char* out, std::int64_t nanos)
+{
+    // floor, so times before the epoch still get 0-999999 microseconds
+    std::int64_t second = nanos / 1000000000;
+    std::int64_t sub = nanos % 1000000000;
+    if(sub < 0) {
+        second--;
+        sub += 1000000000;
+    }
+
+    if(second != cache.second) {
+        std::time_t t = static_cast<std::time_t>(second);
+        std::tm tm_buf;
+        localtime_r(&t, &tm_buf);
+        std::strftime(cache.prefix, sizeof(cache.prefix), "%Y-%m-%d %H:%M:%S", &tm_buf);
+        cache.second = second;
+    }
+
+    std::memcpy(out, cache.prefix, 19);
+    out[19] = '.';
+    unsigned micros = static_cast<unsigned>(sub / 1000);
+    for(int i = 25; i > 19; --i) {
+        out[i] = static_cast<char>('0' + micros % 10);
+        micros /= 10;
+    }
+    return TIMESTAMP_LEN;
+}
+
+
+} // namespace hft
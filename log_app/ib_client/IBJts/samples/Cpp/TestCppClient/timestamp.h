@@ -0,0 +1,32 @@
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <cstdint>
+#include <cstddef> // size_t
+
+
+namespace hft {
+
+
+/* length of "YYYY-MM-DD HH:MM:SS.ffffff" (no terminating NUL) */
+const std::size_t TIMESTAMP_LEN = 26;
+
+
+/**
+ * @brief writes nanoseconds since the epoch as a local time with
+ * microseconds, the format a datetime(6) column takes
+ *
+ * The "YYYY-MM-DD HH:MM:SS" part is cached per thread and only
+ * redone (with localtime_r) when the second changes, so most calls
+ * just copy it and append six digits. Safe to call from any thread.
+ *
+ * @param out at least TIMESTAMP_LEN chars (not NUL terminated)
+ * @param nanos nanoseconds since the epoch
+ * @return TIMESTAMP_LEN
+ */
+std::size_t formatTimestamp(char* out, std::int64_t nanos);
+
+
+} // namespace hft
+
+#endif // TIMESTAMP_H
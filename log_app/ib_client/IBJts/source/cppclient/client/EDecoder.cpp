@@ -14,6 +14,8 @@
 #include "EClientMsgSink.h"
 #include "PriceIncrement.h"
 #include "EOrderDecoder.h"
+#include "EViewWrapper.h"
+#include "EMessageFilter.h"
 
 #include <string.h>
 #include <cstdlib>
@@ -25,10 +27,20 @@
 
 EDecoder::EDecoder(int serverVersion, EWrapper *callback, EClientMsgSink *clientMsgSink) {
 	m_pEWrapper = callback;
+	m_pViewWrapper = 0;
+	m_pFilter = 0;
 	m_serverVersion = serverVersion;
 	m_pClientMsgSink = clientMsgSink;
 }
 
+void EDecoder::setViewWrapper(EViewWrapper *viewWrapper) {
+	m_pViewWrapper = viewWrapper;
+}
+
+void EDecoder::setMessageFilter(const EMessageFilter *filter) {
+	m_pFilter = filter;
+}
+
 const char* EDecoder::processTickPriceMsg(const char* ptr, const char* endPtr) {
 	int version;
 	int tickerId;
@@ -204,6 +216,14 @@ const char* EDecoder::processTickStringMsg(const char* ptr, const char* endPtr)
 	DECODE_FIELD( version);
 	DECODE_FIELD( tickerId);
 	DECODE_FIELD( tickTypeInt);
+
+	if (m_pViewWrapper) {
+		EStringView valueView;
+		DECODE_FIELD( valueView);
+		m_pViewWrapper->tickString( tickerId, (TickType)tickTypeInt, valueView);
+		return ptr;
+	}
+
 	DECODE_FIELD( value);
 
 	m_pEWrapper->tickString( tickerId, (TickType)tickTypeInt, value);
@@ -795,10 +815,17 @@ const char* EDecoder::processMarketDepthL2Msg(const char* ptr, const char* endPt
 	int size;
 	bool isSmartDepth = false;
 
+	EStringView marketMakerView;
+
 	DECODE_FIELD( version);
 	DECODE_FIELD( id);
 	DECODE_FIELD( position);
-	DECODE_FIELD( marketMaker);
+	if (m_pViewWrapper) {
+		DECODE_FIELD( marketMakerView);
+	}
+	else {
+		DECODE_FIELD( marketMaker);
+	}
 	DECODE_FIELD( operation);
 	DECODE_FIELD( side);
 	DECODE_FIELD( price);
@@ -808,6 +835,12 @@ const char* EDecoder::processMarketDepthL2Msg(const char* ptr, const char* endPt
 		DECODE_FIELD( isSmartDepth);
 	}
 
+	if (m_pViewWrapper) {
+		m_pViewWrapper->updateMktDepthL2( id, position, marketMakerView, operation, side,
+			price, size, isSmartDepth);
+		return ptr;
+	}
+
 	m_pEWrapper->updateMktDepthL2( id, position, marketMaker, operation, side,
 		price, size, isSmartDepth);
 
@@ -2031,6 +2064,16 @@ const char* EDecoder::processTickByTickDataMsg(const char* ptr, const char* endP
             tickAttribLast.pastLimit = mask[0];
             tickAttribLast.unreported = mask[1];
 
+            if (m_pViewWrapper) {
+                EStringView exchangeView;
+                EStringView specialConditionsView;
+                DECODE_FIELD(exchangeView);
+                DECODE_FIELD(specialConditionsView);
+
+                m_pViewWrapper->tickByTickAllLast(reqId, tickType, time, price, size, tickAttribLast, exchangeView, specialConditionsView);
+                return ptr;
+            }
+
             DECODE_FIELD(exchange);
             DECODE_FIELD(specialConditions);
 
@@ -2171,6 +2214,12 @@ int EDecoder::parseAndProcessMsg(const char*& beginPtr, const char* endPtr) {
 	if (m_serverVersion == 0)
 		return processConnectAck(beginPtr, endPtr);
 
+	if (m_pFilter && !m_pFilter->wants(EMessageFilter::peekMsgId(beginPtr, endPtr))) {
+		int processed = endPtr - beginPtr;
+		beginPtr = endPtr;
+		return processed;
+	}
+
 	try {
 
 		const char* ptr = beginPtr;
@@ -2520,6 +2569,85 @@ const char* EDecoder::FindFieldEnd(const char* ptr, const char* endPtr)
 	return (const char*)memchr(ptr, 0, endPtr - ptr);
 }
 
+// Numeric fields are converted while looking for their terminator, so the
+// field is only read once. What the fast parsers below don't take (leading
+// blanks, exponents, junk after the number, more digits than they can
+// convert exactly) goes to atoi/atof as before, so results don't change.
+
+#define IS_DIGIT(c) ((unsigned int)((c) - '0') < 10)
+
+// a plain [+-]digits field; returns its terminating NUL, or 0 to fall back
+static const char* ParseIntegerField(const char* ptr, const char* endPtr, long long& value)
+{
+	bool negative = false;
+	if (ptr < endPtr && (*ptr == '-' || *ptr == '+')) {
+		negative = (*ptr == '-');
+		++ptr;
+	}
+
+	const char* digits = ptr;
+	unsigned long long acc = 0;
+	while (ptr < endPtr && IS_DIGIT(*ptr)) {
+		acc = acc * 10 + (*ptr - '0');
+		++ptr;
+	}
+
+	if (ptr == endPtr || *ptr != 0 || ptr - digits > 18)
+		return 0;
+
+	value = negative ? -(long long)acc : (long long)acc;
+	return ptr;
+}
+
+static const double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// a plain [+-]digits[.digits] field; returns its terminating NUL, or 0 to
+// fall back. The digits are collected into an integer, and when that is
+// below 2^53 it and the power of ten are both exact doubles, so the one
+// division rounds the same way strtod would.
+static const char* ParseDecimalField(const char* ptr, const char* endPtr, double& value)
+{
+	bool negative = false;
+	if (ptr < endPtr && (*ptr == '-' || *ptr == '+')) {
+		negative = (*ptr == '-');
+		++ptr;
+	}
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int fraction = 0;
+	while (ptr < endPtr && IS_DIGIT(*ptr)) {
+		mantissa = mantissa * 10 + (*ptr - '0');
+		++digits;
+		++ptr;
+	}
+	if (ptr < endPtr && *ptr == '.') {
+		++ptr;
+		while (ptr < endPtr && IS_DIGIT(*ptr)) {
+			mantissa = mantissa * 10 + (*ptr - '0');
+			++digits;
+			++fraction;
+			++ptr;
+		}
+	}
+
+	if (ptr == endPtr || *ptr != 0 || digits > 19 || fraction > 22 || mantissa > (1ULL << 53))
+		return 0;
+
+	if (digits == 0) {
+		value = 0;   // what atof makes of "", "-" or "."
+		return ptr;
+	}
+
+	value = (double)mantissa / POW10[fraction];
+	if (negative)
+		value = -value;
+	return ptr;
+}
+
 bool EDecoder::DecodeField(bool& boolValue, const char*& ptr, const char* endPtr)
 {
 	int intValue;
@@ -2533,8 +2661,15 @@ bool EDecoder::DecodeField(int& intValue, const char*& ptr, const char* endPtr)
 {
 	if( !CheckOffset(ptr, endPtr))
 		return false;
+	long long value;
+	const char* fieldEnd = ParseIntegerField(ptr, endPtr, value);
+	if( fieldEnd) {
+		intValue = (int)value;
+		ptr = ++fieldEnd;
+		return true;
+	}
 	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
+	fieldEnd = FindFieldEnd(fieldBeg, endPtr);
 	if( !fieldEnd)
 		return false;
 	intValue = atoi(fieldBeg);
@@ -2546,8 +2681,15 @@ bool EDecoder::DecodeFieldTime(time_t& time_tValue, const char*& ptr, const char
 {
 	if( !CheckOffset(ptr, endPtr))
 		return false;
+	long long value;
+	const char* fieldEnd = ParseIntegerField(ptr, endPtr, value);
+	if( fieldEnd) {
+		time_tValue = (time_t)value;
+		ptr = ++fieldEnd;
+		return true;
+	}
 	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
+	fieldEnd = FindFieldEnd(fieldBeg, endPtr);
 	if( !fieldEnd)
 		return false;
 	time_tValue = atoll(fieldBeg);
@@ -2559,8 +2701,15 @@ bool EDecoder::DecodeField(long long& longLongValue, const char*& ptr, const cha
 {
 	if( !CheckOffset(ptr, endPtr))
 		return false;
+	long long value;
+	const char* fieldEnd = ParseIntegerField(ptr, endPtr, value);
+	if( fieldEnd) {
+		longLongValue = (long long)value;
+		ptr = ++fieldEnd;
+		return true;
+	}
 	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
+	fieldEnd = FindFieldEnd(fieldBeg, endPtr);
 	if( !fieldEnd)
 		return false;
 	longLongValue = atoll(fieldBeg);
@@ -2572,8 +2721,15 @@ bool EDecoder::DecodeField(long& longValue, const char*& ptr, const char* endPtr
 {
 	if( !CheckOffset(ptr, endPtr))
 		return false;
+	long long value;
+	const char* fieldEnd = ParseIntegerField(ptr, endPtr, value);
+	if( fieldEnd) {
+		longValue = (long)value;
+		ptr = ++fieldEnd;
+		return true;
+	}
 	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
+	fieldEnd = FindFieldEnd(fieldBeg, endPtr);
 	if( !fieldEnd)
 		return false;
 	longValue = atol(fieldBeg);
@@ -2585,8 +2741,13 @@ bool EDecoder::DecodeField(double& doubleValue, const char*& ptr, const char* en
 {
 	if( !CheckOffset(ptr, endPtr))
 		return false;
+	const char* fieldEnd = ParseDecimalField(ptr, endPtr, doubleValue);
+	if( fieldEnd) {
+		ptr = ++fieldEnd;
+		return true;
+	}
 	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
+	fieldEnd = FindFieldEnd(fieldBeg, endPtr);
 	if( !fieldEnd)
 		return false;
 	doubleValue = atof(fieldBeg);
@@ -2608,6 +2769,20 @@ bool EDecoder::DecodeField(std::string& stringValue,
 	return true;
 }
 
+bool EDecoder::DecodeField(EStringView& stringView,
+						   const char*& ptr, const char* endPtr)
+{
+	if( !CheckOffset(ptr, endPtr))
+		return false;
+	const char* fieldBeg = ptr;
+	const char* fieldEnd = FindFieldEnd(ptr, endPtr);
+	if( !fieldEnd)
+		return false;
+	stringView = EStringView(fieldBeg, fieldEnd - fieldBeg);
+	ptr = ++fieldEnd;
+	return true;
+}
+
 bool EDecoder::DecodeField(char& charValue,
 						   const char*& ptr, const char* endPtr)
 {
@@ -2624,11 +2799,14 @@ bool EDecoder::DecodeField(char& charValue,
 
 bool EDecoder::DecodeFieldMax(int& intValue, const char*& ptr, const char* endPtr)
 {
-	std::string stringValue;
-	if( !DecodeField(stringValue, ptr, endPtr))
+	if( !CheckOffset(ptr, endPtr))
 		return false;
-	intValue = stringValue.empty() ? UNSET_INTEGER : atoi(stringValue.c_str());
-	return true;
+	if( *ptr == 0) {
+		intValue = UNSET_INTEGER;
+		++ptr;
+		return true;
+	}
+	return DecodeField(intValue, ptr, endPtr);
 }
 
 bool EDecoder::DecodeFieldMax(long& longValue, const char*& ptr, const char* endPtr)
@@ -2642,11 +2820,14 @@ bool EDecoder::DecodeFieldMax(long& longValue, const char*& ptr, const char* end
 
 bool EDecoder::DecodeFieldMax(double& doubleValue, const char*& ptr, const char* endPtr)
 {
-	std::string stringValue;
-	if( !DecodeField(stringValue, ptr, endPtr))
+	if( !CheckOffset(ptr, endPtr))
 		return false;
-	doubleValue = stringValue.empty() ? UNSET_DOUBLE : atof(stringValue.c_str());
-	return true;
+	if( *ptr == 0) {
+		doubleValue = UNSET_DOUBLE;
+		++ptr;
+		return true;
+	}
+	return DecodeField(doubleValue, ptr, endPtr);
 }
 
 const char* EDecoder::decodeLastTradeDate(const char* ptr, const char* endPtr, ContractDetails& contract, bool isBond) {
@@ -10,6 +10,7 @@
 #include "HistoricalTick.h"
 #include "HistoricalTickBidAsk.h"
 #include "HistoricalTickLast.h"
+#include "EStringView.h"
 
 
 
@@ -230,11 +231,15 @@ struct ScanData {
 } // end of anonymous namespace
 
 class EWrapper;
+class EViewWrapper;
+class EMessageFilter;
 struct EClientMsgSink;
 
 class TWSAPIDLLEXP EDecoder
 {
     EWrapper *m_pEWrapper;
+    EViewWrapper *m_pViewWrapper;
+    const EMessageFilter *m_pFilter;
     int m_serverVersion;
     EClientMsgSink *m_pClientMsgSink;
 
@@ -340,6 +345,7 @@ public:
     static bool DecodeField(double&, const char*& ptr, const char* endPtr);
     static bool DecodeField(std::string&, const char*& ptr, const char* endPtr);
     static bool DecodeField(char&, const char*& ptr, const char* endPtr);
+    static bool DecodeField(EStringView&, const char*& ptr, const char* endPtr);
 
     static bool DecodeFieldTime(time_t&, const char*& ptr, const char* endPtr);
 
@@ -349,6 +355,14 @@ public:
 
     EDecoder(int serverVersion, EWrapper *callback, EClientMsgSink *clientMsgSink = 0);
 
+    // hand text-carrying market data to views instead of EWrapper (see EViewWrapper)
+    void setViewWrapper(EViewWrapper *viewWrapper);
+
+    // skip the messages filter doesn't want without decoding them; 0 for
+    // none. Only for decoders given one message at a time, the way
+    // processMsgs() does (a skipped message is taken to end at endPtr).
+    void setMessageFilter(const EMessageFilter *filter);
+
     int parseAndProcessMsg(const char*& beginPtr, const char* endPtr);
 };
 
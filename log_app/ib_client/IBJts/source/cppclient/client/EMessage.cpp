@@ -5,10 +5,36 @@
 #include "EMessage.h"
 
 
-EMessage::EMessage(const std::vector<char> &data) {
+EMessage::EMessage()
+    : m_times()
+{
+}
+
+EMessage::EMessage(const std::vector<char> &data)
+    : m_times()
+{
     this->data = data;
 }
 
+EMessage::EMessage(const char *data, size_t size)
+    : data(data, data + size)
+    , m_times()
+{
+}
+
+void EMessage::assign(const char *data, size_t size) {
+    this->data.assign(data, data + size);
+}
+
+void EMessage::trim(size_t maxCapacity) {
+    if (data.capacity() > maxCapacity)
+        std::vector<char>().swap(data);
+}
+
+size_t EMessage::capacity() const {
+    return data.capacity();
+}
+
 const char* EMessage::begin(void) const
 {
     return data.data();
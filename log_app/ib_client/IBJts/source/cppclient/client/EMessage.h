@@ -8,11 +8,33 @@
 #include <vector>
 #include "platformspecific.h"
 
+// when a message went through EReader, in nanoseconds since the epoch
+// (system_clock); only filled in while EReader::traceLatency() is on
+struct EMessageTimes
+{
+    long long received;  // the read that completed it
+    long long queued;    // handed over to processMsgs()
+    long long decoding;  // processMsgs() started decoding it
+};
+
 class TWSAPIDLLEXP EMessage
 {
     std::vector<char> data;
+    EMessageTimes m_times;
 public:
+    EMessage();
     EMessage(const std::vector<char> &data);
+    EMessage(const char *data, size_t size);
+
+    // replaces the contents, reusing the storage when it is big enough
+    void assign(const char *data, size_t size);
+    // gives back storage beyond maxCapacity
+    void trim(size_t maxCapacity);
+    size_t capacity() const;
+
+    EMessageTimes& times() { return m_times; }
+    const EMessageTimes& times() const { return m_times; }
+
     const char* begin(void) const;
     const char* end(void) const;
 };
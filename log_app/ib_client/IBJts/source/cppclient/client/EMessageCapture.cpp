@@ -0,0 +1,121 @@
+#include "StdAfx.h"
+#include "EMessageCapture.h"
+#include "EDecoder.h"
+
+#include <string.h>
+
+// the reader thread only hands stdio a few dozen bytes per message
+#define CAPTURE_BUF_SIZE (1 << 20)
+
+ECaptureWriter::ECaptureWriter()
+	: m_file(0)
+{
+}
+
+ECaptureWriter::~ECaptureWriter() {
+	close();
+}
+
+bool ECaptureWriter::open(const char *path, int serverVersion) {
+	close();
+
+	m_file = fopen(path, "ab");
+	if (!m_file)
+		return false;
+
+	setvbuf(m_file, 0, _IOFBF, CAPTURE_BUF_SIZE);
+
+	unsigned int magic = CAPTURE_MAGIC;
+	if (fwrite(&magic, sizeof(magic), 1, m_file) != 1 || fwrite(&serverVersion, sizeof(serverVersion), 1, m_file) != 1) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void ECaptureWriter::close() {
+	if (m_file) {
+		fclose(m_file);
+		m_file = 0;
+	}
+}
+
+void ECaptureWriter::write(long long receivedAt, const char *msg, unsigned int size) {
+	if (!m_file)
+		return;
+
+	// a capture that can't be written any more stops, rather than holding up the reader
+	if (fwrite(&size, sizeof(size), 1, m_file) != 1
+		|| fwrite(&receivedAt, sizeof(receivedAt), 1, m_file) != 1
+		|| fwrite(msg, 1, size, m_file) != size)
+		close();
+}
+
+void ECaptureWriter::flush() {
+	if (m_file && fflush(m_file) != 0)
+		close();
+}
+
+ECaptureReader::ECaptureReader()
+	: m_file(0)
+	, m_serverVersion(0)
+{
+}
+
+ECaptureReader::~ECaptureReader() {
+	close();
+}
+
+bool ECaptureReader::open(const char *path) {
+	close();
+
+	m_file = fopen(path, "rb");
+	if (!m_file)
+		return false;
+
+	unsigned int magic = 0;
+	if (fread(&magic, sizeof(magic), 1, m_file) != 1 || magic != CAPTURE_MAGIC
+		|| fread(&m_serverVersion, sizeof(m_serverVersion), 1, m_file) != 1) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void ECaptureReader::close() {
+	if (m_file) {
+		fclose(m_file);
+		m_file = 0;
+	}
+}
+
+bool ECaptureReader::next(long long &receivedAt, const char *&msg, unsigned int &size) {
+	if (!m_file)
+		return false;
+
+	for (;;) {
+		if (fread(&size, sizeof(size), 1, m_file) != 1)
+			return false;
+
+		if (size != CAPTURE_MAGIC)
+			break;
+
+		// the next connection
+		if (fread(&m_serverVersion, sizeof(m_serverVersion), 1, m_file) != 1)
+			return false;
+	}
+
+	if (size > (unsigned int)MAX_MSG_LEN)
+		return false;
+
+	if (m_msg.size() < size)
+		m_msg.resize(size);
+
+	if (fread(&receivedAt, sizeof(receivedAt), 1, m_file) != 1 || fread(m_msg.data(), 1, size, m_file) != size)
+		return false;
+
+	msg = m_msg.data();
+	return true;
+}
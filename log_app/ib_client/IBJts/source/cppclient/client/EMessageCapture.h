@@ -0,0 +1,61 @@
+#pragma once
+#ifndef TWS_API_CLIENT_EMESSAGECAPTURE_H
+#define TWS_API_CLIENT_EMESSAGECAPTURE_H
+
+#include <stdio.h>
+#include <vector>
+#include "platformspecific.h"
+
+// A capture file holds the messages the gateway sent, as they were
+// framed, so they can be decoded again later (see EReplay).
+//
+// Each connection starts a session: the 4-byte CAPTURE_MAGIC and the
+// server version. Then every message is its size (4 bytes), the time it
+// was received (8 bytes, nanoseconds since the epoch) and its fields.
+// All numbers are in host byte order. A size is never above MAX_MSG_LEN,
+// so the magic can't be mistaken for one, and a file written across
+// reconnects is just several sessions in a row.
+#define CAPTURE_MAGIC 0x31504143  // "CAP1"
+
+class TWSAPIDLLEXP ECaptureWriter
+{
+	FILE *m_file;
+
+public:
+	ECaptureWriter();
+	~ECaptureWriter();
+
+	// appends a new session to path; false if it can't be opened
+	bool open(const char *path, int serverVersion);
+	void close();
+	bool isOpen() const { return m_file != 0; }
+
+	void write(long long receivedAt, const char *msg, unsigned int size);
+
+	// hands what's buffered to the OS, so the file is whole up to here
+	void flush();
+};
+
+class TWSAPIDLLEXP ECaptureReader
+{
+	FILE *m_file;
+	int m_serverVersion;
+	std::vector<char> m_msg;
+
+public:
+	ECaptureReader();
+	~ECaptureReader();
+
+	// false if path can't be opened or doesn't start with a session
+	bool open(const char *path);
+	void close();
+
+	// the next message, which stays valid until the following call;
+	// false at the end of the file or at a truncated message
+	bool next(long long &receivedAt, const char *&msg, unsigned int &size);
+
+	// of the session the last message belongs to
+	int serverVersion() const { return m_serverVersion; }
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "StdAfx.h"
+#include "EMessageFilter.h"
+#include "EDecoder.h"
+
+EMessageFilter::EMessageFilter() {
+	wantAll();
+}
+
+void EMessageFilter::wantAll() {
+	m_wanted.set();
+}
+
+void EMessageFilter::wantNone() {
+	m_wanted.reset();
+	m_wanted.set(ERR_MSG);
+}
+
+void EMessageFilter::want(int msgId, bool on) {
+	if (msgId < 0 || msgId > MAX_MSG_ID || msgId == ERR_MSG)
+		return;
+	m_wanted.set(msgId, on);
+}
+
+int EMessageFilter::peekMsgId(const char *ptr, const char *endPtr) {
+	int msgId = 0;
+	const char *p = ptr;
+
+	// message ids have three digits at most
+	for (; p < endPtr && p - ptr < 4 && *p >= '0' && *p <= '9'; ++p)
+		msgId = msgId * 10 + (*p - '0');
+
+	if (p == ptr || p == endPtr || *p != 0)
+		return -1;
+	return msgId;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef TWS_API_CLIENT_EMESSAGEFILTER_H
+#define TWS_API_CLIENT_EMESSAGEFILTER_H
+
+#include <bitset>
+#include "platformspecific.h"
+
+// Which incoming message types (the msgId constants in EDecoder.h) are
+// wanted. Unwanted messages are dropped as soon as they are framed,
+// before their fields are decoded, see EReader::setMessageFilter().
+// Error messages are always wanted: they also report lost connections.
+class TWSAPIDLLEXP EMessageFilter
+{
+	enum { MAX_MSG_ID = 255 };
+	std::bitset<MAX_MSG_ID + 1> m_wanted;
+
+public:
+	// wants everything
+	EMessageFilter();
+
+	void wantAll();
+	// nothing but errors; then want() the types to keep
+	void wantNone();
+	void want(int msgId, bool on = true);
+
+	// ids that aren't plain numbers, or are past the last known one, are
+	// wanted, so the decoder still gets to report them
+	bool wants(int msgId) const { return msgId < 0 || msgId > MAX_MSG_ID || m_wanted[msgId]; }
+	bool wantsAll() const { return m_wanted.all(); }
+
+	// the msgId a message starts with, without decoding the rest of it;
+	// -1 if the first field isn't a plain number
+	static int peekMsgId(const char *ptr, const char *endPtr);
+};
+
+#endif
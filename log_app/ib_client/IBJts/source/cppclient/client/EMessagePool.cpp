@@ -0,0 +1,100 @@
+#include "StdAfx.h"
+#include "EMessagePool.h"
+#include "EMessage.h"
+
+#include <string.h>
+
+#define MESSAGES_PER_SLAB 256
+// released messages on their way back to acquire(); past this they take the lock
+#define RETURN_RING_SIZE (16 * 1024)
+// released messages bigger than this give their storage back
+#define MAX_POOLED_CAPACITY (64 * 1024)
+
+// single writer, so no read-modify-write
+static void bump(std::atomic<unsigned long long> &n) {
+	n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+EMessagePool::EMessagePool()
+	: m_returned(RETURN_RING_SIZE)
+	, m_overflowed(false)
+	, m_messages(0)
+	, m_slabCount(0)
+	, m_buffers(0)
+	, m_recycled(0)
+	, m_released(0)
+{
+}
+
+EMessagePool::~EMessagePool() {
+}
+
+// moves whatever the consumer gave back into m_free, allocating a slab
+// if that was nothing
+void EMessagePool::refill() {
+	while (EMessage *msg = m_returned.pop())
+		m_free.push_back(msg);
+
+	if (m_overflowed.load(std::memory_order_acquire)) {
+		EMutexGuard lock(m_csOverflow);
+		m_free.insert(m_free.end(), m_overflow.begin(), m_overflow.end());
+		m_overflow.clear();
+		m_overflowed.store(false, std::memory_order_relaxed);
+	}
+
+	if (m_free.empty()) {
+		m_slabs.push_back(std::unique_ptr<EMessage[]>(new EMessage[MESSAGES_PER_SLAB]));
+		m_free.reserve(m_slabs.size() * MESSAGES_PER_SLAB);
+		for (int i = MESSAGES_PER_SLAB - 1; i >= 0; --i)
+			m_free.push_back(&m_slabs.back()[i]);
+		bump(m_slabCount);
+	}
+}
+
+EMessage *EMessagePool::acquire(const char *data, size_t size) {
+	if (m_free.empty())
+		refill();
+
+	EMessage *msg = m_free.back();
+	m_free.pop_back();
+	bump(m_messages);
+	if (msg->capacity() < size)
+		bump(m_buffers);
+
+	msg->assign(data, size);
+	return msg;
+}
+
+void EMessagePool::recycle(EMessage *msg) {
+	if (!msg)
+		return;
+
+	msg->trim(MAX_POOLED_CAPACITY);
+	m_free.push_back(msg);
+	bump(m_recycled);
+}
+
+void EMessagePool::release(EMessage *msg) {
+	if (!msg)
+		return;
+
+	msg->trim(MAX_POOLED_CAPACITY);
+
+	if (!m_returned.push(msg)) {
+		EMutexGuard lock(m_csOverflow);
+		m_overflow.push_back(msg);
+		m_overflowed.store(true, std::memory_order_release);
+	}
+	bump(m_released);
+}
+
+EMessagePoolStats EMessagePool::stats() {
+	EMessagePoolStats stats;
+	stats.messages = m_messages.load(std::memory_order_relaxed);
+	stats.slabs = m_slabCount.load(std::memory_order_relaxed);
+	stats.buffers = m_buffers.load(std::memory_order_relaxed);
+	// the counters are read one at a time, so this is only a snapshot
+	unsigned long long back = m_recycled.load(std::memory_order_relaxed) + m_released.load(std::memory_order_relaxed);
+	stats.inUse = stats.messages > back ? stats.messages - back : 0;
+	return stats;
+}
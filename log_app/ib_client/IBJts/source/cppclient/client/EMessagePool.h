@@ -0,0 +1,70 @@
+#pragma once
+#ifndef TWS_API_CLIENT_EMESSAGEPOOL_H
+#define TWS_API_CLIENT_EMESSAGEPOOL_H
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <stddef.h>
+#include "platformspecific.h"
+#include "EMutex.h"
+#include "EMessageRing.h"
+
+class EMessage;
+
+// what the pool has allocated so far; once traffic settles
+// (slabs + buffers) / messages drops towards zero
+struct EMessagePoolStats
+{
+	unsigned long long messages;   // messages handed out by acquire()
+	unsigned long long slabs;      // slabs of EMessage objects allocated
+	unsigned long long buffers;    // times a message had to (re)allocate its bytes
+	unsigned long long inUse;      // messages not yet released
+};
+
+// Recycles the EMessages EReader hands to processMsgs(). Messages are
+// allocated a slab at a time and keep their byte storage when released,
+// so in steady state acquire() allocates nothing.
+//
+// acquire() and recycle() belong to one thread (the reader), release()
+// to one other (the one calling processMsgs()). Released messages go
+// back through a lock-free ring, which acquire() drains into its own
+// free list once that runs dry, so neither side takes a lock per
+// message. Only when the ring is full do releases spill into a locked
+// list.
+class TWSAPIDLLEXP EMessagePool
+{
+	std::vector<std::unique_ptr<EMessage[]> > m_slabs;
+	std::vector<EMessage*> m_free;        // only touched by acquire() and recycle()
+	EMessageRing m_returned;              // release() -> acquire()
+	std::vector<EMessage*> m_overflow;    // releases that didn't fit in m_returned
+	EMutex m_csOverflow;
+	std::atomic<bool> m_overflowed;       // m_overflow may be non-empty
+
+	// each written by one side only
+	std::atomic<unsigned long long> m_messages;
+	std::atomic<unsigned long long> m_slabCount;
+	std::atomic<unsigned long long> m_buffers;
+	std::atomic<unsigned long long> m_recycled;
+	std::atomic<unsigned long long> m_released;
+
+	EMessagePool(const EMessagePool&);
+	EMessagePool& operator=(const EMessagePool&);
+
+	void refill();
+
+public:
+	EMessagePool();
+	~EMessagePool();
+
+	// a message holding a copy of [data, data + size)
+	EMessage *acquire(const char *data, size_t size);
+	// hands a message back from the thread that calls acquire()
+	void recycle(EMessage *msg);
+	// hands a message back from the consuming thread
+	void release(EMessage *msg);
+
+	EMessagePoolStats stats();
+};
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef TWS_API_CLIENT_EMESSAGERING_H
+#define TWS_API_CLIENT_EMESSAGERING_H
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include "platformspecific.h"
+
+class EMessage;
+
+// Bounded lock-free queue of messages between exactly one producer (the
+// reader thread) and one consumer (the thread calling processMsgs).
+// The capacity is rounded up to a power of two.
+class TWSAPIDLLEXP EMessageRing
+{
+	std::vector<EMessage*> m_slots;
+	const size_t m_mask;
+	// the cursors sit on separate cache lines (padding rather than alignas,
+	// which plain new doesn't honour before C++17)
+	char m_pad0[64];
+	std::atomic<size_t> m_head;  // next slot to read, only written by the consumer
+	char m_pad1[64];
+	std::atomic<size_t> m_tail;  // next slot to write, only written by the producer
+	char m_pad2[64];
+
+	static size_t roundUp(size_t n) {
+		size_t p = 2;
+		while (p < n)
+			p <<= 1;
+		return p;
+	}
+
+	EMessageRing(const EMessageRing&);
+	EMessageRing& operator=(const EMessageRing&);
+
+public:
+	explicit EMessageRing(size_t capacity)
+		: m_slots(roundUp(capacity))
+		, m_mask(m_slots.size() - 1)
+		, m_head(0)
+		, m_tail(0)
+	{
+	}
+
+	// producer side; false if the ring is full
+	bool push(EMessage *msg) {
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+			return false;
+		m_slots[tail & m_mask] = msg;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side; 0 if the ring is empty
+	EMessage *pop() {
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+			return 0;
+		EMessage *msg = m_slots[head & m_mask];
+		m_head.store(head + 1, std::memory_order_release);
+		return msg;
+	}
+
+	bool full() const {
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire) == m_slots.size();
+	}
+
+	bool empty() const {
+		return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+	}
+
+	size_t capacity() const { return m_slots.size(); }
+
+	// from any thread, so only a snapshot
+	size_t size() const {
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+	}
+};
+
+#endif
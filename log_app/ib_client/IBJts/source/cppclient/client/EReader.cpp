@@ -11,13 +11,30 @@
 #include "EReaderSignal.h"
 #include "EMessage.h"
 #include "DefaultEWrapper.h"
+#include "EReaderEpoll.h"
+#include "EThreadAffinity.h"
+#include "TwsSocketClientErrors.h"
+
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#if defined(IBAPI_HAS_EPOLL)
+#include <sys/epoll.h>
+#endif
 
 #define IN_BUF_SIZE_DEFAULT 8192
 
 static DefaultEWrapper defaultWrapper;
 
+static long long nowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 EReader::EReader(EClientSocket *clientSocket, EReaderSignal *signal)
 	: processMsgsDecoder_(clientSocket->EClient::serverVersion(), clientSocket->getWrapper(), clientSocket)
+	, m_buf(IN_BUF_SIZE_DEFAULT)
 #if defined(IB_POSIX)
     , m_hReadThread(pthread_self())
 #elif defined(IB_WIN32)
@@ -28,10 +45,127 @@ EReader::EReader(EClientSocket *clientSocket, EReaderSignal *signal)
         m_pClientSocket = clientSocket;       
 		m_pEReaderSignal = signal;
 		m_nMaxBufSize = IN_BUF_SIZE_DEFAULT;
-		m_buf.reserve(IN_BUF_SIZE_DEFAULT);
+		m_signalled = false;
+		m_skipped = 0;
+		for (int i = 0; i <= MAX_COUNTED_MSG_ID + 1; ++i)
+			m_received[i] = 0;
+		m_receivedAt = 0;
+		m_trace = false;
+		m_decoding = EMessageTimes();
+		m_cpu = -1;
+		m_pLoop = 0;
+		m_epollFd = -1;
+		m_epollSockFd = -1;
+		m_readable = false;
+#if defined(IBAPI_EPOLL)
+		useEpoll(true);
+#endif
+}
+
+#if defined(IBAPI_HAS_EPOLL)
+EReader::EReader(EClientSocket *clientSocket, EReaderSignal *signal, EReaderEpoll *loop)
+	: processMsgsDecoder_(clientSocket->EClient::serverVersion(), clientSocket->getWrapper(), clientSocket)
+	, m_buf(IN_BUF_SIZE_DEFAULT)
+    , m_hReadThread(pthread_self())
+{
+		m_isAlive = true;
+        m_pClientSocket = clientSocket;       
+		m_pEReaderSignal = signal;
+		m_nMaxBufSize = IN_BUF_SIZE_DEFAULT;
+		m_signalled = false;
+		m_skipped = 0;
+		for (int i = 0; i <= MAX_COUNTED_MSG_ID + 1; ++i)
+			m_received[i] = 0;
+		m_receivedAt = 0;
+		m_trace = false;
+		m_decoding = EMessageTimes();
+		m_cpu = -1;
+		m_pLoop = loop;
+		m_epollFd = -1;
+		m_epollSockFd = -1;
+		m_readable = false;
+}
+#endif
+
+bool EReader::useEpoll(bool on) {
+#if defined(IBAPI_HAS_EPOLL)
+	if (on == (m_epollFd >= 0))
+		return true;
+
+	if (on) {
+		m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+		return m_epollFd >= 0;
+	}
+
+	close(m_epollFd);
+	m_epollFd = -1;
+	m_epollSockFd = -1;
+	return true;
+#else
+	return !on;
+#endif
+}
+
+void EReader::useLockFreeQueue(unsigned int capacity) {
+	if (capacity > 0)
+		m_msgRing.reset(new EMessageRing(capacity));
+	else
+		m_msgRing.reset();
+}
+
+void EReader::setCpu(int cpu) {
+	m_cpu = cpu;
+}
+
+void EReader::useViewCallbacks(EViewWrapper *viewWrapper) {
+	processMsgsDecoder_.setViewWrapper(viewWrapper);
+}
+
+void EReader::setMessageFilter(const EMessageFilter &filter) {
+	m_filter = filter;
+	processMsgsDecoder_.setMessageFilter(m_filter.wantsAll() ? 0 : &m_filter);
+}
+
+bool EReader::captureTo(const char *path) {
+	return m_capture.open(path, m_pClientSocket->EClient::serverVersion());
+}
+
+void EReader::traceLatency(bool on) {
+	m_trace = on;
+}
+
+// whether a framed v100 message gets past the filter
+bool EReader::wanted(const char *msg, unsigned int size) {
+	int msgId = EMessageFilter::peekMsgId(msg, msg + size);
+	count(msgId);
+	if (m_filter.wants(msgId))
+		return true;
+	m_skipped.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void EReader::count(int msgId) {
+	std::atomic<unsigned long long> &n = m_received[msgId >= 0 && msgId <= MAX_COUNTED_MSG_ID ? msgId : MAX_COUNTED_MSG_ID + 1];
+	n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+unsigned long long EReader::messagesReceived(int msgId) const {
+	return m_received[msgId >= 0 && msgId <= MAX_COUNTED_MSG_ID ? msgId : MAX_COUNTED_MSG_ID + 1].load(std::memory_order_relaxed);
+}
+
+void EReader::capture(const char *msg, unsigned int size) {
+	if (m_capture.isOpen())
+		m_capture.write(m_receivedAt, msg, size);
 }
 
 EReader::~EReader(void) {
+#if defined(IBAPI_HAS_EPOLL)
+    if (m_pLoop) {
+        m_pLoop->remove(this);
+        m_isAlive = false;
+        m_pClientSocket->eDisconnect();
+    }
+#endif
 #if defined(IB_POSIX)
     if (!pthread_equal(pthread_self(), m_hReadThread)) {
         m_isAlive = false;
@@ -45,9 +179,16 @@ EReader::~EReader(void) {
         WaitForSingleObject(m_hReadThread, INFINITE);
     }
 #endif
+	useEpoll(false);
 }
 
 void EReader::start() {
+#if defined(IBAPI_HAS_EPOLL)
+    if (m_pLoop) {
+        m_pLoop->add(this);
+        return;
+    }
+#endif
 #if defined(IB_POSIX)
     pthread_create( &m_hReadThread, NULL, readToQueueThread, this );
 #elif defined(IB_WIN32)
@@ -67,6 +208,11 @@ DWORD WINAPI EReader::readToQueueThread(LPVOID lpParam)
 {
 	EReader *pThis = reinterpret_cast<EReader *>(lpParam);
 
+	// the thread still reads, just wherever the scheduler puts it
+	if (pThis->m_cpu >= 0 && !ePinCurrentThread(pThis->m_cpu))
+		pThis->m_pClientSocket->getWrapper()->error(NO_VALID_ID, FAIL_PIN_THREAD.code(),
+			FAIL_PIN_THREAD.msg() + std::to_string(pThis->m_cpu));
+
 	pThis->readToQueue();
 	return 0;
 }
@@ -95,17 +241,83 @@ bool EReader::putMessageToQueue() {
 	if (msg == 0)
 		return false;
 
-	{
-		EMutexGuard lock(m_csMsgQueue);
-		m_msgQueue.push_back(std::shared_ptr<EMessage>(msg));
-	}
+	enqueue(msg);
 
-	m_pEReaderSignal->issueSignal();
+	// whatever else is already buffered goes out with the same signal
+	bool bad = false;
+	while (queueHasRoom() && (msg = tryReadSingleMsg(bad)) != 0)
+		enqueue(msg);
+
+	signalBurst();
 
 	return true;
 }
 
+void EReader::enqueue(EMessage *msg) {
+	// nothing is read between framing a message and queueing it, so the
+	// last read is the one that completed it
+	if (m_trace) {
+		msg->times().received = m_receivedAt;
+		msg->times().queued = nowNanos();
+	}
+
+	if (m_msgRing) {
+		while (!m_msgRing->push(msg)) {
+			if (!m_isAlive) {
+				m_msgPool.recycle(msg);
+				return;
+			}
+			// full: make sure the consumer is awake, then give it the CPU
+			m_signalled = true;
+			m_pEReaderSignal->issueSignal();
+			std::this_thread::yield();
+		}
+		return;
+	}
+
+	EMutexGuard lock(m_csMsgQueue);
+	m_msgQueue.push_back(msg);
+}
+
+bool EReader::queueHasRoom() {
+	return !m_msgRing || !m_msgRing->full();
+}
+
+size_t EReader::queueDepth() {
+	if (m_msgRing)
+		return m_msgRing->size();
+
+	EMutexGuard lock(m_csMsgQueue);
+	return m_msgQueue.size();
+}
+
+bool EReader::queueEmpty() {
+	if (m_msgRing)
+		return m_msgRing->empty();
+
+	EMutexGuard lock(m_csMsgQueue);
+	return m_msgQueue.empty();
+}
+
+// One signal per burst: the consumer clears m_signalled when it finds the
+// queue empty (see popMsg()), so until then messages go out unannounced.
+void EReader::signalBurst() {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!m_signalled.exchange(true))
+		m_pEReaderSignal->issueSignal();
+
+	// after the signal, so the decoding thread isn't kept waiting on the
+	// write; a capture is then complete up to the last burst
+	if (m_capture.isOpen())
+		m_capture.flush();
+}
+
 bool EReader::processNonBlockingSelect() {
+#if defined(IBAPI_HAS_EPOLL)
+	if (m_epollFd >= 0)
+		return processEpoll();
+#endif
+
 	fd_set readSet, writeSet, errorSet;
 	struct timeval tval;
 
@@ -164,21 +376,145 @@ bool EReader::processNonBlockingSelect() {
 	return false;
 }
 
+#if defined(IBAPI_HAS_EPOLL)
+bool EReader::processEpoll() {
+	int fd = m_pClientSocket->fd();
+
+	if (fd < 0) {
+		m_epollSockFd = -1;
+		return false;
+	}
+
+	// (re)register after connecting, reconnecting or a redirect
+	if (fd != m_epollSockFd) {
+		struct epoll_event ev;
+		ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		ev.data.fd = fd;
+		if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0 && errno != EEXIST) {
+			m_pClientSocket->eDisconnect();
+			return false;
+		}
+		m_epollSockFd = fd;
+		m_readable = true;
+	}
+
+	// whatever is left from the last edge comes first
+	if (m_readable)
+		return handleEpollEvents(0);
+
+	struct epoll_event ev;
+	int ret = epoll_wait(m_epollFd, &ev, 1, 100);
+
+	if (ret == 0) { // timeout
+		// a socket that was closed and reopened under the same number drops out of the set
+		struct epoll_event mod;
+		mod.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		mod.data.fd = fd;
+		if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &mod) < 0 && errno == ENOENT)
+			m_epollSockFd = -1;
+		return false;
+	}
+
+	if (ret < 0) { // error
+		if (errno == EINTR)
+			return false;
+		m_pClientSocket->eDisconnect();
+		return false;
+	}
+
+	return handleEpollEvents(ev.events);
+}
+
+bool EReader::handleEpollEvents(unsigned int events) {
+	if (events & EPOLLERR) {
+		// error on socket
+		m_pClientSocket->onError();
+	}
+
+	if (m_pClientSocket->fd() < 0)
+		return false;
+
+	if ((events & EPOLLOUT) && !m_pClientSocket->getTransport()->isOutBufferEmpty()) {
+		// socket is ready for writing
+		onSend();
+	}
+
+	if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+		m_readable = true;
+
+	// there's no new edge until recv() comes up short, so keep reading until it does
+	size_t space = m_nMaxBufSize > m_buf.size() ? m_nMaxBufSize - m_buf.size() : 0;
+
+	if (m_readable && space > 0) {
+		int nRes = onReceive();
+
+		if (nRes < (int)space)
+			m_readable = false;
+	}
+
+	return m_pClientSocket->fd() >= 0;
+}
+
+void EReader::onEpollEvent(unsigned int events) {
+	bool queued = false;
+	bool bad = false;
+
+	// read and frame in turns, since the buffer may fill up before the socket is drained;
+	// a reader with more to read than that gets another turn later
+	for (int turn = 0; turn < 16 && m_pClientSocket->fd() >= 0; ++turn) {
+		handleEpollEvents(turn == 0 ? events : 0);
+
+		EMessage *msg;
+		while (queueHasRoom() && (msg = tryReadSingleMsg(bad)) != 0) {
+			enqueue(msg);
+			queued = true;
+		}
+
+		if (bad) {
+			m_pClientSocket->eDisconnect();
+			break;
+		}
+
+		// the ring is full; come back to what's buffered once processMsgs() has caught up
+		if (!queueHasRoom()) {
+			m_readable = true;
+			break;
+		}
+
+		if (!m_readable)
+			break;
+	}
+
+	if (queued)
+		signalBurst();
+
+	if (m_pClientSocket->fd() < 0) {
+		m_isAlive = false;
+		m_readable = false;
+		m_pClientSocket->handleSocketError();
+		m_pEReaderSignal->issueSignal(); //letting client know that socket was closed
+	}
+}
+#endif
+
 void EReader::onSend() {
 	m_pEReaderSignal->issueSignal();
 }
 
-void EReader::onReceive() {
-	int nOffset = m_buf.size();
+int EReader::onReceive() {
+	size_t space = m_nMaxBufSize > m_buf.size() ? m_nMaxBufSize - m_buf.size() : 0;
 
-	m_buf.resize(m_nMaxBufSize);
-	
-	int nRes = m_pClientSocket->receive(m_buf.data() + nOffset, m_buf.size() - nOffset);
+	int nRes = m_pClientSocket->receive(m_buf.prepare(space), space);
 
 	if (nRes <= 0)
-		return;
+		return nRes;
 
- 	m_buf.resize(nRes + nOffset);	
+ 	m_buf.commit(nRes);
+
+	if (m_capture.isOpen() || m_trace)
+		m_receivedAt = nowNanos();
+
+	return nRes;
 }
 
 bool EReader::bufferedRead(char *buf, unsigned int size) {
@@ -188,11 +524,9 @@ bool EReader::bufferedRead(char *buf, unsigned int size) {
 				return false;
 		}
 
-		int nBytes = (std::min<unsigned int>)(m_nMaxBufSize, size);
+		unsigned int nBytes = (std::min<size_t>)(m_buf.size(), size);
 
-		std::copy(m_buf.begin(), m_buf.begin() + nBytes, buf);
-		std::copy(m_buf.begin() + nBytes, m_buf.end(), m_buf.begin());
-		m_buf.resize(m_buf.size() - nBytes);
+		m_buf.read(buf, nBytes);
 
 		size -= nBytes;
 		buf += nBytes;
@@ -203,22 +537,41 @@ bool EReader::bufferedRead(char *buf, unsigned int size) {
 
 EMessage * EReader::readSingleMsg() {
 	if (m_pClientSocket->usingV100Plus()) {
-		int msgSize;
+		// unwanted messages are dropped here, so read until one isn't
+		while (m_isAlive) {
+			int msgSize;
 
-		if (!bufferedRead((char *)&msgSize, sizeof(msgSize)))
-			return 0;
+			if (!bufferedRead((char *)&msgSize, sizeof(msgSize)))
+				return 0;
 
-		msgSize = ntohl(msgSize);
+			msgSize = ntohl(msgSize);
 
-		if (msgSize <= 0 || msgSize > MAX_MSG_LEN)
-			return 0;
+			if (msgSize <= 0 || msgSize > MAX_MSG_LEN)
+				return 0;
 
-		std::vector<char> buf = std::vector<char>(msgSize);
+			// wait for the whole message, then take it straight out of the buffer
+			if ((unsigned int)msgSize > m_nMaxBufSize)
+				m_nMaxBufSize = msgSize;
 
-		if (!bufferedRead(buf.data(), buf.size()))
-			return 0;
+			while (m_buf.size() < (unsigned int)msgSize) {
+				if (!processNonBlockingSelect() && !m_pClientSocket->isSocketOK())
+					return 0;
+			}
+
+			capture(m_buf.data(), msgSize);
+
+			if (!wanted(m_buf.data(), msgSize)) {
+				m_buf.consume(msgSize);
+				continue;
+			}
 
-		return new EMessage(buf);
+			EMessage *msg = m_msgPool.acquire(m_buf.data(), msgSize);
+			m_buf.consume(msgSize);
+
+			return msg;
+		}
+
+		return 0;
 	}
 	else {
 		const char *pBegin = 0;
@@ -238,53 +591,161 @@ EMessage * EReader::readSingleMsg() {
 			msgSize = EDecoder(m_pClientSocket->EClient::serverVersion(), &defaultWrapper).parseAndProcessMsg(pBegin, pEnd);
 		}
 	
-		std::vector<char> msgData(msgSize);
+		// the decoder only returns a size once the whole message is buffered
+		capture(m_buf.data(), msgSize);
+		count(EMessageFilter::peekMsgId(m_buf.data(), m_buf.data() + msgSize));
 
-		if (!bufferedRead(msgData.data(), msgSize))
-			return 0;
+		EMessage * msg = m_msgPool.acquire(m_buf.data(), msgSize);
+		m_buf.consume(msgSize);
 
 		if (m_buf.size() < IN_BUF_SIZE_DEFAULT && m_buf.capacity() > IN_BUF_SIZE_DEFAULT)
 		{
-			m_buf.resize(m_nMaxBufSize = IN_BUF_SIZE_DEFAULT);
-			m_buf.shrink_to_fit();
+			m_buf.shrink(m_nMaxBufSize = IN_BUF_SIZE_DEFAULT);
 		}
 
-		EMessage * msg = new EMessage(msgData);
+		return msg;
+	}
+}
+
+EMessage * EReader::tryReadSingleMsg(bool &bad) {
+	bad = false;
+
+	if (m_pClientSocket->usingV100Plus()) {
+		for (;;) {
+			int msgSize;
+
+			if (m_buf.size() < sizeof(msgSize))
+				return 0;
+
+			memcpy(&msgSize, m_buf.data(), sizeof(msgSize));
+			msgSize = ntohl(msgSize);
+
+			if (msgSize <= 0 || msgSize > MAX_MSG_LEN) {
+				bad = true;
+				return 0;
+			}
+
+			unsigned int frameSize = sizeof(msgSize) + msgSize;
+
+			if (m_buf.size() < frameSize) {
+				if (m_nMaxBufSize < frameSize)
+					m_nMaxBufSize = frameSize;
+				return 0;
+			}
+
+			capture(m_buf.data() + sizeof(msgSize), msgSize);
+
+			if (!wanted(m_buf.data() + sizeof(msgSize), msgSize)) {
+				m_buf.consume(frameSize);
+				continue;
+			}
+
+			EMessage *msg = m_msgPool.acquire(m_buf.data() + sizeof(msgSize), msgSize);
+			m_buf.consume(frameSize);
+
+			return msg;
+		}
+	}
+	else {
+		if (m_buf.empty())
+			return 0;
+
+		const char *pBegin = m_buf.data();
+		const char *pEnd = pBegin + m_buf.size();
+		int msgSize = EDecoder(m_pClientSocket->EClient::serverVersion(), &defaultWrapper).parseAndProcessMsg(pBegin, pEnd);
+
+		if (msgSize <= 0) {
+			if (m_buf.size() >= m_nMaxBufSize * 3/4) 
+				m_nMaxBufSize *= 2;
+			return 0;
+		}
+
+		capture(m_buf.data(), msgSize);
+		count(EMessageFilter::peekMsgId(m_buf.data(), m_buf.data() + msgSize));
+
+		EMessage *msg = m_msgPool.acquire(m_buf.data(), msgSize);
+		m_buf.consume(msgSize);
 
 		return msg;
 	}
 }
 
 std::shared_ptr<EMessage> EReader::getMsg(void) {
-	EMutexGuard lock(m_csMsgQueue);
+	EMessage *msg = popMsg();
 
-	if (m_msgQueue.size() == 0) {
+	if (!msg)
 		return std::shared_ptr<EMessage>();
-	}
 
-	std::shared_ptr<EMessage> msg = m_msgQueue.front();
-	m_msgQueue.pop_front();
+	EMessagePool *pool = &m_msgPool;
+	return std::shared_ptr<EMessage>(msg, [pool](EMessage *m) { pool->release(m); });
+}
+
+EMessage * EReader::popMsg(void) {
+	EMessage *msg = 0;
+
+	for (int attempt = 0; attempt < 2; ++attempt) {
+		if (m_msgRing) {
+			msg = m_msgRing->pop();
+		}
+		else {
+			EMutexGuard lock(m_csMsgQueue);
+
+			if (m_msgQueue.size() > 0) {
+				msg = m_msgQueue.front();
+				m_msgQueue.pop_front();
+			}
+		}
+
+		if (msg || attempt > 0)
+			break;
+
+		// caught up: the next burst needs a signal again. Look once more,
+		// for a message the reader queued before seeing the flag cleared
+		m_signalled.exchange(false);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
 
 	return msg;
 }
 
+void EReader::stampDecoding(EMessage *msg) {
+	if (m_trace) {
+		m_decoding = msg->times();
+		m_decoding.decoding = nowNanos();
+	}
+}
+
+EMessagePoolStats EReader::messagePoolStats() {
+	return m_msgPool.stats();
+}
+
 
 void EReader::processMsgs(void) {
 	m_pClientSocket->onSend();
 
-	std::shared_ptr<EMessage> msg = getMsg();
+	EMessage *msg = popMsg();
 
-	if (!msg.get())
+	if (!msg)
 		return;
 
 	const char *pBegin = msg->begin();
+	stampDecoding(msg);
 
 	while (processMsgsDecoder_.parseAndProcessMsg(pBegin, msg->end()) > 0) {
-		msg = getMsg();
+		m_msgPool.release(msg);
+		msg = popMsg();
 
-		if (!msg.get())
+		if (!msg)
 			break;
 
 		pBegin = msg->begin();
-	} 
+		stampDecoding(msg);
+	}
+
+	if (msg) {
+		m_msgPool.release(msg);
+		// stopped early, so the rest won't be announced again
+		if (!queueEmpty())
+			m_pEReaderSignal->issueSignal();
+	}
 }
@@ -7,23 +7,44 @@
 
 #include <atomic>
 #include <deque>
+#include <memory>
 #include "platformspecific.h"
 #include "EDecoder.h"
 #include "EMutex.h"
 #include "EReaderOSSignal.h"
+#include "EReaderBuffer.h"
+#include "EMessagePool.h"
+#include "EMessageRing.h"
+#include "EMessageFilter.h"
+#include "EMessageCapture.h"
+#include "EMessage.h"
 
 class EClientSocket;
 struct EReaderSignal;
-class EMessage;
+class EReaderEpoll;
+class EViewWrapper;
 
 class TWSAPIDLLEXP EReader
 {  
+    enum { MAX_COUNTED_MSG_ID = 255 };
+
     EClientSocket *m_pClientSocket;
     EReaderSignal *m_pEReaderSignal;
     EDecoder processMsgsDecoder_;
-    std::deque<std::shared_ptr<EMessage>> m_msgQueue;
+    EMessagePool m_msgPool;
+    std::deque<EMessage*> m_msgQueue;
     EMutex m_csMsgQueue;
-    std::vector<char> m_buf;
+    std::unique_ptr<EMessageRing> m_msgRing;  // replaces m_msgQueue when set, see useLockFreeQueue()
+    std::atomic<bool> m_signalled;            // a signal is out that processMsgs() hasn't caught up with
+    EReaderBuffer m_buf;
+    EMessageFilter m_filter;
+    std::atomic<unsigned long long> m_skipped;  // messages m_filter dropped
+    // messages framed per msgId, the last for the rest; only the reader thread writes them
+    std::atomic<unsigned long long> m_received[MAX_COUNTED_MSG_ID + 2];
+    ECaptureWriter m_capture;
+    long long m_receivedAt;  // of the last bytes read, for m_capture and m_trace
+    bool m_trace;  // stamp messages with EMessageTimes, see traceLatency()
+    EMessageTimes m_decoding;  // of the message processMsgs() is decoding
     std::atomic<bool> m_isAlive;
 #if defined(IB_POSIX)
     pthread_t m_hReadThread;
@@ -31,18 +52,87 @@ class TWSAPIDLLEXP EReader
     HANDLE m_hReadThread;
 #endif
 	unsigned int m_nMaxBufSize;
+	int m_cpu;  // the reader thread is pinned to this CPU, -1 for none
+
+	// epoll transport (Linux only, see useEpoll() and EReaderEpoll)
+	EReaderEpoll *m_pLoop;   // shared event loop serving this reader, if any
+	int m_epollFd;           // this reader's own epoll set, -1 for select()
+	int m_epollSockFd;       // the socket currently registered for epoll
+	bool m_readable;         // edge triggered: the socket may still hold unread data
 
-	void onReceive();
+	int onReceive();
 	void onSend();
 	bool bufferedRead(char *buf, unsigned int size);
+	bool wanted(const char *msg, unsigned int size);
+	void count(int msgId);
+	void capture(const char *msg, unsigned int size);
+	void stampDecoding(EMessage *msg);
 
 public:
     EReader(EClientSocket *clientSocket, EReaderSignal *signal);
+#if defined(IBAPI_HAS_EPOLL)
+    // served by loop's thread instead of one of its own (see EReaderEpoll)
+    EReader(EClientSocket *clientSocket, EReaderSignal *signal, EReaderEpoll *loop);
+#endif
     ~EReader(void);
 
+	// wait on the socket with edge-triggered epoll instead of select();
+	// call before start(). Returns false if epoll isn't available here.
+	// Defaults to on when built with IBAPI_EPOLL.
+	bool useEpoll(bool on);
+
+	// hand messages to processMsgs() through a bounded lock-free ring of
+	// (at least) capacity messages instead of a locked deque; 0 goes back
+	// to the deque. Call before start(). When the ring is full the reader
+	// stops reading until processMsgs() catches up.
+	void useLockFreeQueue(unsigned int capacity);
+
+	// pin the reader thread to one CPU (see ePinCurrentThread); call
+	// before start(). If that fails, the thread reports FAIL_PIN_THREAD
+	// through EWrapper::error and runs unpinned. A reader served by an
+	// EReaderEpoll runs on the loop's thread instead, see
+	// EReaderEpoll::setCpu().
+	void setCpu(int cpu);
+
+	// decode tick-by-tick trades, tick strings and L2 depth into views of
+	// the message (see EViewWrapper); 0 goes back to EWrapper
+	void useViewCallbacks(EViewWrapper *viewWrapper);
+
+	// drop the message types filter doesn't want as soon as they are
+	// framed, so they are neither copied, queued nor decoded; call before
+	// start(). Before protocol v100 messages are only framed by decoding
+	// them, so there the filter just spares processMsgs() the second pass.
+	void setMessageFilter(const EMessageFilter &filter);
+
+	// append every message to path as it is framed, filtered or not,
+	// with the time it was received (see EMessageCapture.h and EReplay);
+	// call before start(). Returns false if path can't be opened.
+	bool captureTo(const char *path);
+
+	// stamp every message with when it was read, queued and decoded (a
+	// clock read at each of the last two); call before start(). Off by
+	// default. See messageTimes().
+	void traceLatency(bool on);
+
 protected:
 	bool processNonBlockingSelect();
+#if defined(IBAPI_HAS_EPOLL)
+	bool processEpoll();
+	bool handleEpollEvents(unsigned int events);
+	void onEpollEvent(unsigned int events);
+	friend class EReaderEpoll;
+#endif
+	void enqueue(EMessage *msg);
+	bool queueHasRoom();
+	bool queueEmpty();
+	void signalBurst();
+	EMessage * tryReadSingleMsg(bool &bad);
+	// the returned message goes back to the pool when the last copy is
+	// dropped, which has to happen on the thread that calls processMsgs(),
+	// before the reader is destroyed
     std::shared_ptr<EMessage> getMsg(void);
+	// the returned message has to be handed back with m_msgPool.release()
+	EMessage * popMsg(void);
     void readToQueue();
 #if defined(IB_POSIX)
     static void * readToQueueThread(void * lpParam);
@@ -56,7 +146,19 @@ protected:
 
 public:
     void processMsgs(void);
+	// allocation counts for the messages handed to processMsgs()
+	EMessagePoolStats messagePoolStats();
+	// messages dropped by the filter so far
+	unsigned long long messagesSkipped() const { return m_skipped; }
+	// messages framed so far that start with msgId, filtered or not;
+	// any id past 255 (or that isn't a number) counts as -1
+	unsigned long long messagesReceived(int msgId) const;
+	// messages waiting for processMsgs()
+	size_t queueDepth();
 	bool putMessageToQueue();
+	// with traceLatency() on, the stamps of the message being decoded;
+	// only meaningful from inside the callbacks processMsgs() makes
+	const EMessageTimes& messageTimes() const { return m_decoding; }
 	void start();
 };
 
@@ -0,0 +1,56 @@
+#include "StdAfx.h"
+#include "EReaderBuffer.h"
+
+#include <string.h>
+#include <assert.h>
+
+EReaderBuffer::EReaderBuffer(size_t capacity)
+	: m_data(capacity)
+	, m_begin(0)
+	, m_end(0)
+{
+}
+
+char *EReaderBuffer::prepare(size_t want) {
+	if (m_data.size() - m_end < want) {
+		// slide the unread bytes to the front first, and only grow if that's not enough
+		size_t unread = size();
+		if (m_begin > 0) {
+			memmove(m_data.data(), m_data.data() + m_begin, unread);
+			m_begin = 0;
+			m_end = unread;
+		}
+		if (m_data.size() - m_end < want)
+			m_data.resize(m_end + want);
+	}
+
+	return m_data.data() + m_end;
+}
+
+void EReaderBuffer::commit(size_t n) {
+	assert(m_end + n <= m_data.size());
+	m_end += n;
+}
+
+void EReaderBuffer::consume(size_t n) {
+	assert(n <= size());
+	m_begin += n;
+	if (m_begin == m_end)
+		m_begin = m_end = 0;
+}
+
+void EReaderBuffer::read(char *buf, size_t n) {
+	memcpy(buf, data(), n);
+	consume(n);
+}
+
+void EReaderBuffer::shrink(size_t capacity) {
+	if (m_data.size() <= capacity || size() > capacity)
+		return;
+
+	std::vector<char> smaller(capacity);
+	memcpy(smaller.data(), data(), size());
+	m_end = size();
+	m_begin = 0;
+	m_data.swap(smaller);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef TWS_API_CLIENT_EREADERBUFFER_H
+#define TWS_API_CLIENT_EREADERBUFFER_H
+
+#include <vector>
+#include <stddef.h>
+#include "platformspecific.h"
+
+// Receive buffer for EReader. Unread bytes sit between a read cursor
+// and a write cursor in one contiguous block, so a message can always be
+// framed (and decoded) in place. Consuming bytes only moves the read
+// cursor; the unread tail is moved back to the front only when recv()
+// needs room at the end, so the cost per byte stays constant however
+// much is buffered.
+class TWSAPIDLLEXP EReaderBuffer
+{
+    std::vector<char> m_data;
+    size_t m_begin;  // first unread byte
+    size_t m_end;    // one past the last unread byte
+
+public:
+    explicit EReaderBuffer(size_t capacity);
+
+    const char *data() const { return m_data.data() + m_begin; }
+    size_t size() const { return m_end - m_begin; }
+    bool empty() const { return m_begin == m_end; }
+    size_t capacity() const { return m_data.size(); }
+
+    // room for at least want more bytes at the end, to be filled by recv()
+    // and then committed
+    char *prepare(size_t want);
+    void commit(size_t n);
+
+    // drops n bytes from the front
+    void consume(size_t n);
+
+    // copies n bytes from the front out and drops them
+    void read(char *buf, size_t n);
+
+    // gives back memory beyond capacity if what's buffered fits
+    void shrink(size_t capacity);
+};
+
+#endif
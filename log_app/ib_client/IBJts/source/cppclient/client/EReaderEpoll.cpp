@@ -0,0 +1,161 @@
+#include "StdAfx.h"
+#include "EReaderEpoll.h"
+
+#if defined(IBAPI_HAS_EPOLL)
+
+#include <algorithm>
+#include <sys/epoll.h>
+#include "EClientSocket.h"
+#include "EReader.h"
+#include "EThreadAffinity.h"
+#include "EWrapper.h"
+#include "TwsSocketClientErrors.h"
+
+#define MAX_EPOLL_EVENTS 64
+
+EReaderEpoll::EReaderEpoll()
+	: m_epollFd(epoll_create1(EPOLL_CLOEXEC))
+	, m_hReadThread(pthread_self())
+	, m_started(false)
+	, m_cpu(-1)
+	, m_pinFailed(false)
+{
+	m_isAlive = false;
+}
+
+EReaderEpoll::~EReaderEpoll() {
+	stop();
+	if (m_epollFd >= 0)
+		close(m_epollFd);
+}
+
+void EReaderEpoll::start() {
+	if (m_started || m_epollFd < 0)
+		return;
+	m_isAlive = true;
+	m_started = (pthread_create(&m_hReadThread, NULL, loopThread, this) == 0);
+}
+
+void EReaderEpoll::stop() {
+	if (!m_started)
+		return;
+	m_isAlive = false;
+	pthread_join(m_hReadThread, NULL);
+	m_started = false;
+}
+
+void EReaderEpoll::setCpu(int cpu) {
+	m_cpu = cpu;
+}
+
+void * EReaderEpoll::loopThread(void * lpParam) {
+	EReaderEpoll *pThis = reinterpret_cast<EReaderEpoll *>(lpParam);
+
+	if (pThis->m_cpu >= 0 && !ePinCurrentThread(pThis->m_cpu)) {
+		// readers added from now on are told in add()
+		EMutexGuard lock(pThis->m_csReaders);
+		pThis->m_pinFailed = true;
+		for (size_t i = 0; i < pThis->m_readers.size(); ++i)
+			pThis->reportPinFailure(pThis->m_readers[i]);
+	}
+
+	pThis->loop();
+	return 0;
+}
+
+void EReaderEpoll::reportPinFailure(EReader *reader) {
+	reader->m_pClientSocket->getWrapper()->error(NO_VALID_ID, FAIL_PIN_THREAD.code(),
+		FAIL_PIN_THREAD.msg() + std::to_string(m_cpu));
+}
+
+bool EReaderEpoll::registerSocket(EReader *reader) {
+	int fd = reader->m_pClientSocket->fd();
+
+	if (fd < 0)
+		return false;
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.ptr = reader;
+	if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0 && errno != EEXIST)
+		return false;
+
+	reader->m_epollSockFd = fd;
+	// bytes that arrived before registering don't make an edge
+	reader->m_readable = true;
+	return true;
+}
+
+bool EReaderEpoll::add(EReader *reader) {
+	EMutexGuard lock(m_csReaders);
+
+	if (!registerSocket(reader))
+		return false;
+
+	m_readers.push_back(reader);
+	if (m_pinFailed)
+		reportPinFailure(reader);
+	return true;
+}
+
+void EReaderEpoll::remove(EReader *reader) {
+	EMutexGuard lock(m_csReaders);
+
+	std::vector<EReader*>::iterator it = std::find(m_readers.begin(), m_readers.end(), reader);
+	if (it == m_readers.end())
+		return;
+
+	int fd = reader->m_pClientSocket->fd();
+	if (fd >= 0)
+		epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, NULL);
+	m_readers.erase(it);
+}
+
+void EReaderEpoll::loop() {
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	int timeout = 100;
+
+	while (m_isAlive) {
+		int n = epoll_wait(m_epollFd, events, MAX_EPOLL_EVENTS, timeout);
+
+		if (n < 0 && errno != EINTR)
+			break;
+
+		EMutexGuard lock(m_csReaders);
+
+		for (int i = 0; i < n; ++i) {
+			EReader *reader = static_cast<EReader *>(events[i].data.ptr);
+			// it may have been removed since epoll_wait returned
+			if (std::find(m_readers.begin(), m_readers.end(), reader) == m_readers.end())
+				continue;
+			reader->onEpollEvent(events[i].events);
+		}
+
+		// readers that still hold unread data, closed sockets, and sockets that
+		// were replaced (redirect) since they were registered
+		timeout = 100;
+		for (size_t i = 0; i < m_readers.size(); ) {
+			EReader *reader = m_readers[i];
+			int fd = reader->m_pClientSocket->fd();
+
+			if (fd < 0 || !reader->m_isAlive) {
+				if (reader->m_isAlive)
+					reader->onEpollEvent(0);
+				m_readers.erase(m_readers.begin() + i);
+				continue;
+			}
+
+			if (fd != reader->m_epollSockFd)
+				registerSocket(reader);
+
+			if (reader->m_readable) {
+				reader->onEpollEvent(0);
+				if (reader->m_readable)
+					timeout = 0;
+			}
+			++i;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef TWS_API_CLIENT_EREADEREPOLL_H
+#define TWS_API_CLIENT_EREADEREPOLL_H
+
+#include "platformspecific.h"
+
+#if defined(IBAPI_HAS_EPOLL)
+
+#include <atomic>
+#include <vector>
+#include "EMutex.h"
+
+class EReader;
+
+// One thread reading any number of client sockets through a single
+// edge-triggered epoll set, instead of one EReader thread per socket.
+//
+//     EReaderEpoll loop;
+//     loop.start();
+//     EReader reader(clientSocket, &signal, &loop);
+//     reader.start();   // registers with the loop
+//
+// Each reader keeps its own message queue and signal, so the decoding
+// side (waitForSignal/processMsgs) doesn't change.
+class TWSAPIDLLEXP EReaderEpoll
+{
+    int m_epollFd;
+    std::atomic<bool> m_isAlive;
+    pthread_t m_hReadThread;
+    bool m_started;
+    int m_cpu;
+    bool m_pinFailed;
+    std::vector<EReader*> m_readers;
+    EMutex m_csReaders;
+
+    bool registerSocket(EReader *reader);
+    void reportPinFailure(EReader *reader);
+    void loop();
+    static void * loopThread(void * lpParam);
+
+public:
+    EReaderEpoll();
+    ~EReaderEpoll();
+
+    void start();
+    void stop();
+
+    // pin the loop thread to one CPU; call before start(). If that
+    // fails, every reader served by the loop reports FAIL_PIN_THREAD
+    // through its EWrapper::error and the loop runs unpinned.
+    void setCpu(int cpu);
+
+    // called by EReader::start() and ~EReader()
+    bool add(EReader *reader);
+    void remove(EReader *reader);
+};
+
+#endif
+
+#endif
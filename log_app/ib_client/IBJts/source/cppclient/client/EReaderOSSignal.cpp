@@ -4,6 +4,8 @@
 #include "StdAfx.h"
 #include "EReaderOSSignal.h"
 
+#include <chrono>
+
 #if defined(IB_POSIX)
 #if defined(IBAPI_MONOTONIC_TIME)
 #include <time.h>
@@ -12,11 +14,36 @@
 #endif
 #endif
 
+#if defined(IBAPI_HAS_FUTEX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CPU_RELAX() _mm_pause()
+#elif defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() ((void)0)
+#endif
+
+// m_state for the spinning strategies
+#define SIGNAL_CLEAR  0
+#define SIGNAL_SET    1
+#define SIGNAL_PARKED 2   // clear, and the waiter sleeps on the futex
+
+// how many polls between looks at the clock
+#define SPINS_PER_CLOCK_CHECK 1024
+
 
 EReaderOSSignal::EReaderOSSignal(unsigned long waitTimeout)
 {
     bool ok = true;
     m_waitTimeout = waitTimeout;
+    m_strategy = WAIT_BLOCK;
+    m_spins = 0;
+    m_state = SIGNAL_CLEAR;
 #if defined(IB_POSIX)
     ok = ok && !pthread_mutex_init(&m_mutex, NULL);
     ok = ok && !pthread_condattr_init(&m_condattr);
@@ -50,7 +77,27 @@ EReaderOSSignal::~EReaderOSSignal(void)
 }
 
 
+bool EReaderOSSignal::setWaitStrategy(WaitStrategy strategy, unsigned int spins) {
+#if !defined(IBAPI_HAS_FUTEX)
+	if (strategy == WAIT_SPIN_THEN_PARK)
+		return false;
+#endif
+	m_strategy = strategy;
+	m_spins = spins;
+	return true;
+}
+
 void EReaderOSSignal::issueSignal() {
+	if (m_strategy != WAIT_BLOCK) {
+#if defined(IBAPI_HAS_FUTEX)
+		if (m_state.exchange(SIGNAL_SET) == SIGNAL_PARKED)
+			syscall(SYS_futex, &m_state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+		m_state.store(SIGNAL_SET);
+#endif
+		return;
+	}
+
 #if defined(IB_POSIX)
     pthread_mutex_lock(&m_mutex);
     open = true;
@@ -63,7 +110,58 @@ void EReaderOSSignal::issueSignal() {
 #endif
 }
 
+void EReaderOSSignal::waitSpinning() {
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point deadline;
+	if (m_waitTimeout != INFINITE)
+		deadline = Clock::now() + std::chrono::milliseconds(m_waitTimeout);
+
+	for (unsigned long spin = 1; ; ++spin) {
+		int expected = SIGNAL_SET;
+		if (m_state.compare_exchange_weak(expected, SIGNAL_CLEAR))
+			return;
+
+		if (m_strategy == WAIT_SPIN_THEN_PARK && spin >= m_spins)
+			break;
+
+		if (spin % SPINS_PER_CLOCK_CHECK == 0 && m_waitTimeout != INFINITE && Clock::now() >= deadline)
+			return;
+
+		CPU_RELAX();
+	}
+
+#if defined(IBAPI_HAS_FUTEX)
+	int expected = SIGNAL_CLEAR;
+	if (m_state.compare_exchange_strong(expected, SIGNAL_PARKED)) {
+		struct timespec ts;
+		struct timespec *timeout = NULL;
+
+		if (m_waitTimeout != INFINITE) {
+			Clock::duration left = deadline - Clock::now();
+			if (left < Clock::duration::zero())
+				left = Clock::duration::zero();
+			long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+			ts.tv_sec = ns / (1000 * 1000 * 1000);
+			ts.tv_nsec = ns % (1000 * 1000 * 1000);
+			timeout = &ts;
+		}
+
+		// returns at once if the signal came in since the exchange
+		syscall(SYS_futex, &m_state, FUTEX_WAIT_PRIVATE, SIGNAL_PARKED, timeout, NULL, 0);
+	}
+#endif
+
+	// consume the signal, or give up on it after a timeout
+	m_state.exchange(SIGNAL_CLEAR);
+}
+
 void EReaderOSSignal::waitForSignal() {
+	if (m_strategy != WAIT_BLOCK) {
+		waitSpinning();
+		return;
+	}
+
 #if defined(IB_POSIX)
     pthread_mutex_lock(&m_mutex); 
     if (!open) {
@@ -6,6 +6,7 @@
 #define TWS_API_CLIENT_EREADEROSSIGNAL_H
 
 #include "EReaderSignal.h"
+#include <atomic>
 #include <stdexcept>
 #include "platformspecific.h"
 
@@ -28,10 +29,29 @@ class TWSAPIDLLEXP EReaderOSSignal :
 #endif
     unsigned long m_waitTimeout; // in milliseconds
 
+public:
+	enum WaitStrategy {
+		WAIT_BLOCK,          // park on the OS event (the default)
+		WAIT_SPIN,           // never give up the CPU; meant for a pinned thread
+		WAIT_SPIN_THEN_PARK  // spin for a while, then park on a futex
+	};
+
+private:
+	WaitStrategy m_strategy;
+	unsigned int m_spins;
+	std::atomic<int> m_state;  // SIGNAL_* (spinning strategies only)
+
+	void waitSpinning();
+
 public:
 	EReaderOSSignal(unsigned long waitTimeout = INFINITE);
 	virtual ~EReaderOSSignal(void);
 
+	// how waitForSignal() waits; call before the signal is used. spins is
+	// the number of polls before parking (WAIT_SPIN_THEN_PARK only).
+	// Returns false and keeps blocking if the strategy isn't available.
+	bool setWaitStrategy(WaitStrategy strategy, unsigned int spins = 0);
+
 	virtual void issueSignal();
 	virtual void waitForSignal();
 };
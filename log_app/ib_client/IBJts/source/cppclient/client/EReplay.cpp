@@ -0,0 +1,84 @@
+#include "StdAfx.h"
+#include "EReplay.h"
+#include "EDecoder.h"
+
+#include <thread>
+
+EReplay::EReplay(EWrapper *wrapper)
+	: m_pWrapper(wrapper)
+	, m_pViewWrapper(0)
+	, m_decoderVersion(0)
+	, m_paced(false)
+	, m_firstAt(-1)
+	, m_messages(0)
+	, m_bytes(0)
+	, m_bad(0)
+{
+}
+
+EReplay::~EReplay() {
+}
+
+bool EReplay::open(const char *path) {
+	m_decoder.reset();
+	m_firstAt = -1;
+	return m_capture.open(path);
+}
+
+void EReplay::setPaced(bool paced) {
+	m_paced = paced;
+}
+
+void EReplay::useViewCallbacks(EViewWrapper *viewWrapper) {
+	m_pViewWrapper = viewWrapper;
+	if (m_decoder)
+		m_decoder->setViewWrapper(viewWrapper);
+}
+
+void EReplay::setMessageFilter(const EMessageFilter &filter) {
+	m_filter = filter;
+	if (m_decoder)
+		m_decoder->setMessageFilter(m_filter.wantsAll() ? 0 : &m_filter);
+}
+
+bool EReplay::next() {
+	long long receivedAt;
+	const char *msg;
+	unsigned int size;
+
+	if (!m_capture.next(receivedAt, msg, size))
+		return false;
+
+	// a new session may come from a gateway that speaks another version
+	if (!m_decoder || m_decoderVersion != m_capture.serverVersion()) {
+		m_decoderVersion = m_capture.serverVersion();
+		m_decoder.reset(new EDecoder(m_decoderVersion, m_pWrapper));
+		m_decoder->setViewWrapper(m_pViewWrapper);
+		m_decoder->setMessageFilter(m_filter.wantsAll() ? 0 : &m_filter);
+	}
+
+	if (m_paced) {
+		if (m_firstAt < 0) {
+			m_firstAt = receivedAt;
+			m_start = std::chrono::steady_clock::now();
+		}
+		else if (receivedAt > m_firstAt) {
+			std::this_thread::sleep_until(m_start + std::chrono::nanoseconds(receivedAt - m_firstAt));
+		}
+	}
+
+	const char *pBegin = msg;
+	if (m_decoder->parseAndProcessMsg(pBegin, msg + size) <= 0)
+		++m_bad;
+
+	++m_messages;
+	m_bytes += size;
+	return true;
+}
+
+unsigned long long EReplay::run() {
+	unsigned long long n = 0;
+	while (next())
+		++n;
+	return n;
+}
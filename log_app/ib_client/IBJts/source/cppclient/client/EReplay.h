@@ -0,0 +1,65 @@
+#pragma once
+#ifndef TWS_API_CLIENT_EREPLAY_H
+#define TWS_API_CLIENT_EREPLAY_H
+
+#include <chrono>
+#include <memory>
+#include "platformspecific.h"
+#include "EMessageCapture.h"
+#include "EMessageFilter.h"
+
+class EDecoder;
+class EWrapper;
+class EViewWrapper;
+
+// Decodes a capture (see EReader::captureTo()) into a wrapper, the way
+// processMsgs() decodes what the reader queued, on the calling thread:
+//
+//     EReplay replay(&wrapper);
+//     if (replay.open("session.cap"))
+//         replay.run();
+//
+// Either as fast as it can, or paced, at the gaps the messages were
+// received with. Nothing is sent anywhere, so callbacks that would
+// send requests (nextValidId, ...) find the client disconnected.
+class TWSAPIDLLEXP EReplay
+{
+	EWrapper *m_pWrapper;
+	EViewWrapper *m_pViewWrapper;
+	EMessageFilter m_filter;
+	ECaptureReader m_capture;
+	std::unique_ptr<EDecoder> m_decoder;
+	int m_decoderVersion;
+
+	bool m_paced;
+	long long m_firstAt;  // when the first message was received, -1 before it
+	std::chrono::steady_clock::time_point m_start;
+
+	unsigned long long m_messages;
+	unsigned long long m_bytes;
+	unsigned long long m_bad;
+
+public:
+	explicit EReplay(EWrapper *wrapper);
+	~EReplay();
+
+	bool open(const char *path);
+
+	// keep the gaps between messages as they were received; off by default
+	void setPaced(bool paced);
+	// as EReader::useViewCallbacks() and EReader::setMessageFilter()
+	void useViewCallbacks(EViewWrapper *viewWrapper);
+	void setMessageFilter(const EMessageFilter &filter);
+
+	// decodes the next message; false once the capture is done
+	bool next();
+	// decodes the rest of the capture; returns how many messages that was
+	unsigned long long run();
+
+	unsigned long long messages() const { return m_messages; }
+	unsigned long long bytes() const { return m_bytes; }
+	// messages the decoder couldn't make sense of
+	unsigned long long bad() const { return m_bad; }
+};
+
+#endif
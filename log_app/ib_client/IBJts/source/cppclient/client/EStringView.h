@@ -0,0 +1,36 @@
+#pragma once
+#ifndef TWS_API_CLIENT_ESTRINGVIEW_H
+#define TWS_API_CLIENT_ESTRINGVIEW_H
+
+#include <string>
+#include <string.h>
+#include <stddef.h>
+
+// A field of a message, left where it is: a pointer into the message
+// and a length. Only valid during the callback it is passed to; copy it
+// out with str() to keep it.
+struct EStringView
+{
+	const char *ptr;
+	size_t len;
+
+	EStringView() : ptr(""), len(0) {}
+	EStringView(const char *p, size_t n) : ptr(p), len(n) {}
+
+	const char *data() const { return ptr; }
+	size_t size() const { return len; }
+	bool empty() const { return len == 0; }
+
+	// a view of a decoded field is always NUL terminated in the message
+	const char *c_str() const { return ptr; }
+
+	std::string str() const { return std::string(ptr, len); }
+
+	bool operator==(const EStringView &other) const {
+		return len == other.len && memcmp(ptr, other.ptr, len) == 0;
+	}
+	bool operator!=(const EStringView &other) const { return !(*this == other); }
+	bool operator==(const char *s) const { return *this == EStringView(s, strlen(s)); }
+};
+
+#endif
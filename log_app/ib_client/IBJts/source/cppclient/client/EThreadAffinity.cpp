@@ -0,0 +1,28 @@
+#include "StdAfx.h"
+#include "EThreadAffinity.h"
+
+#if defined(IBAPI_HAS_AFFINITY)
+#include <sched.h>
+#endif
+
+bool ePinCurrentThread(int cpu) {
+	if (cpu < 0)
+		return false;
+
+#if defined(IBAPI_HAS_AFFINITY)
+	if (cpu >= CPU_SETSIZE)
+		return false;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(IB_WIN32)
+	if (cpu >= (int)(sizeof(DWORD_PTR) * 8))
+		return false;
+
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+	return false;
+#endif
+}
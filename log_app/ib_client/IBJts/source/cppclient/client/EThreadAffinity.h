@@ -0,0 +1,12 @@
+#pragma once
+#ifndef TWS_API_CLIENT_ETHREADAFFINITY_H
+#define TWS_API_CLIENT_ETHREADAFFINITY_H
+
+#include "platformspecific.h"
+
+// Pins the calling thread to one CPU, so a spinning reader or decoder
+// thread keeps its core (and its caches) to itself. Returns false if
+// cpu is out of range or pinning isn't available on this platform.
+TWSAPIDLLEXP bool ePinCurrentThread(int cpu);
+
+#endif
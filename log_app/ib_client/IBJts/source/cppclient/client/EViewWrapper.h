@@ -0,0 +1,27 @@
+#pragma once
+#ifndef TWS_API_CLIENT_EVIEWWRAPPER_H
+#define TWS_API_CLIENT_EVIEWWRAPPER_H
+
+#include <time.h>
+#include "EStringView.h"
+#include "EWrapper.h"
+
+// Callbacks for the market data messages that carry text, taking the
+// text as views into the message instead of std::strings, so decoding
+// them doesn't allocate. Opt in with EReader::useViewCallbacks(); the
+// matching EWrapper callbacks are then no longer called. The other
+// market data callbacks (tickPrice, tickSize, tickByTickBidAsk,
+// updateMktDepth, ...) carry no text and stay on EWrapper.
+class EViewWrapper
+{
+public:
+	virtual ~EViewWrapper() {}
+
+	virtual void tickByTickAllLast(int reqId, int tickType, time_t time, double price, int size,
+		const TickAttribLast& tickAttribLast, EStringView exchange, EStringView specialConditions) = 0;
+	virtual void tickString(TickerId tickerId, TickType tickType, EStringView value) = 0;
+	virtual void updateMktDepthL2(TickerId id, int position, EStringView marketMaker, int operation,
+		int side, double price, int size, bool isSmartDepth) = 0;
+};
+
+#endif
@@ -40,6 +40,11 @@
 #if __cplusplus >= 201103L // strict C++11 standard std::mutex is available
 #define IBAPI_STD_MUTEX
 #endif 
+#if defined(__linux__) // epoll is available (see EReader::useEpoll and EReaderEpoll)
+#define IBAPI_HAS_EPOLL
+#define IBAPI_HAS_FUTEX    // see EReaderOSSignal::setWaitStrategy
+#define IBAPI_HAS_AFFINITY // see EThreadAffinity.h
+#endif
 #else
 #error "Not supported on this platform"
 #endif